@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+// Synthetic .lang projects used as benchmark inputs.
+// The output only depends on the options (including the seed), so results can be compared between runs and machines.
+struct CorpusOptions {
+    size_t   modules = 16;
+    size_t   functions_per_module = 16;
+    size_t   template_depth = 2; // Length of the chain of template functions instantiated by each function, 0 disables templates.
+    size_t   import_fan_out = 3; // Number of modules imported by each module (only the modules generated before it, the graph stays acyclic).
+    uint64_t seed = 1;
+};
+
+struct CorpusFile {
+    std::string name; // Relative path, with extension.
+    std::string source;
+};
+
+class CorpusGenerator {
+  public:
+    explicit CorpusGenerator(const CorpusOptions& options) : _options(options), _state(options.seed) {}
+
+    // One file per module, in dependency order (a module only imports modules listed before it), followed by main.lang which imports the last modules.
+    std::vector<CorpusFile> generate() {
+        std::vector<CorpusFile> files;
+        for(size_t module = 0; module < _options.modules; ++module)
+            files.push_back({module_name(module) + ".lang", generate_module(module)});
+        files.push_back({"main.lang", generate_main()});
+        return files;
+    }
+
+    // Writes the files to folder, returns the path to main.lang or an empty path on failure.
+    static std::filesystem::path write(const std::vector<CorpusFile>& files, const std::filesystem::path& folder) {
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+        if(ec)
+            return {};
+        for(const auto& file : files) {
+            std::ofstream out(folder / file.name, std::ios::binary);
+            out << file.source;
+            if(!out)
+                return {};
+        }
+        return folder / files.back().name;
+    }
+
+  private:
+    CorpusOptions _options;
+    uint64_t      _state;
+
+    // splitmix64: Deterministic and independent of the standard library implementation (unlike std::uniform_int_distribution).
+    uint64_t next() {
+        uint64_t z = (_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    size_t next(size_t bound) { return bound == 0 ? 0 : static_cast<size_t>(next() % bound); }
+
+    static std::string module_name(size_t module) { return fmt::format("module_{}", module); }
+    static std::string getter_name(size_t module, size_t depth) { return fmt::format("get{}_{}", module, depth); }
+
+    // Picks up to count distinct modules among [0, bound).
+    std::vector<size_t> pick_modules(size_t bound, size_t count) {
+        std::vector<size_t> candidates;
+        for(size_t i = 0; i < bound; ++i)
+            candidates.push_back(i);
+        std::vector<size_t> r;
+        while(r.size() < count && !candidates.empty()) {
+            auto idx = next(candidates.size());
+            r.push_back(candidates[idx]);
+            candidates.erase(candidates.begin() + static_cast<ptrdiff_t>(idx));
+        }
+        return r;
+    }
+
+    std::string generate_module(size_t module) {
+        std::string r;
+        const auto  imports = pick_modules(module, _options.import_fan_out);
+        for(const auto& dep : imports)
+            r += fmt::format("import \"{}\"\n", module_name(dep));
+        if(!imports.empty())
+            r += "\n";
+
+        // Chain of templates: Instantiating get{module}_{depth}<T> also instantiates all the levels below it, down to the Box{module}<T> type.
+        if(_options.template_depth > 0)
+            r += fmt::format("export type Box{}<T> {{\n    let value: T;\n    let count: i32;\n}}\n\n", module);
+        for(size_t depth = 0; depth < _options.template_depth; ++depth) {
+            if(depth == 0)
+                r += fmt::format("export function {}<T>(this: Box{}<T>*) : T {{\n    return .value;\n}}\n\n", getter_name(module, depth), module);
+            else
+                r += fmt::format("export function {}<T>(this: Box{}<T>*) : T {{\n    return this.{}();\n}}\n\n", getter_name(module, depth), module, getter_name(module, depth - 1));
+        }
+
+        for(size_t function = 0; function < _options.functions_per_module; ++function) {
+            r += fmt::format("// Accumulates the first b multiples of a step into a, then adjusts the result through the Box{} template and other functions.\n", module);
+            r += fmt::format("export function f{}_{}(a: i32, b: i32) : i32 {{\n", module, function);
+            r += "    let acc: i32 = a;\n";
+            r += fmt::format("    for(let i: i32 = 0; i < b; ++i) {{\n        acc = acc + i * {};\n    }}\n", next(16) + 1);
+            r += fmt::format("    if(acc > {}) {{\n        acc = acc - b;\n    }} else {{\n        acc = acc + {};\n    }}\n", next(1000), next(100));
+            if(_options.template_depth > 0) {
+                r += fmt::format("    let box: Box{}<i32>;\n    box.value = acc;\n    box.count = {};\n", module, function);
+                r += fmt::format("    acc = box.{}();\n", getter_name(module, _options.template_depth - 1));
+            }
+            // Calls into the module itself and its imports.
+            if(function > 0)
+                r += fmt::format("    acc = acc + f{}_{}(b, {});\n", module, next(function), next(8));
+            if(!imports.empty())
+                r += fmt::format("    acc = acc + f{}_{}(acc, {});\n", imports[next(imports.size())], next(_options.functions_per_module), next(8));
+            r += "    return acc;\n}\n\n";
+        }
+        return r;
+    }
+
+    std::string generate_main() {
+        std::string r;
+        const auto  count = std::min(_options.modules, std::max<size_t>(_options.import_fan_out, 1));
+        for(size_t i = 0; i < count; ++i)
+            r += fmt::format("import \"{}\"\n", module_name(_options.modules - 1 - i));
+        r += "\nfunction main() {\n    let r: i32 = 0;\n";
+        if(_options.functions_per_module > 0)
+            for(size_t i = 0; i < count; ++i)
+                r += fmt::format("    r = r + f{}_{}(r, {});\n", _options.modules - 1 - i, next(_options.functions_per_module), next(8));
+        r += "    return 0;\n}\n";
+        return r;
+    }
+};
@@ -0,0 +1,272 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+
+#include <llvm/IR/LLVMContext.h>
+
+#include <compiler/DependencyTree.hpp>
+#include <compiler/Module.hpp>
+#include <Logger.hpp>
+#include <ModuleInterface.hpp>
+#include <Parser.hpp>
+#include <TokenStream.hpp>
+#include <Tokenizer.hpp>
+
+#include "CorpusGenerator.hpp"
+
+namespace {
+
+// Redirects the log of the current thread (parser warnings...), which would otherwise drown the benchmark report.
+class SilenceLog {
+  public:
+    SilenceLog() : _previous(log_buffer) { log_buffer = &_buffer; }
+    ~SilenceLog() { log_buffer = _previous; }
+
+  private:
+    std::string  _buffer;
+    std::string* _previous;
+};
+
+std::vector<Token> tokenize(const std::string& source) {
+    std::vector<Token> tokens;
+    Tokenizer          tokenizer(source);
+    while(tokenizer.has_more())
+        tokens.push_back(tokenizer.consume());
+    return tokens;
+}
+
+size_t count_nodes(const AST::Node& node) {
+    size_t r = 1;
+    for(const auto child : node.children)
+        r += count_nodes(*child);
+    return r;
+}
+
+struct ParsedModule {
+    std::filesystem::path path;
+    std::string           source;
+    std::vector<Token>    tokens;
+    Parser                parser;
+    std::optional<AST>    ast;
+};
+
+// A generated project written to a temporary folder.
+class Project {
+  public:
+    std::filesystem::path   folder;
+    std::filesystem::path   cache_folder;
+    std::filesystem::path   main_file;
+    std::vector<CorpusFile> files;
+
+    static Project& get(const CorpusOptions& options) {
+        static std::map<std::tuple<size_t, size_t, size_t, size_t, uint64_t>, std::unique_ptr<Project>> projects;
+        auto& project = projects[{options.modules, options.functions_per_module, options.template_depth, options.import_fan_out, options.seed}];
+        if(!project)
+            project.reset(new Project(options));
+        return *project;
+    }
+
+    // The last generated module: It has the most dependencies to choose its imports from.
+    // All of the modules are parsed (once) in dependency order: The interfaces of its dependencies are available in cache_folder, as they would be during a build.
+    ParsedModule& last_module() {
+        if(_modules.empty())
+            parse_modules();
+        return *_modules[_modules.size() - 2];
+    }
+
+    ~Project() {
+        std::error_code ec;
+        std::filesystem::remove_all(folder, ec);
+    }
+
+  private:
+    explicit Project(const CorpusOptions& options) {
+        folder = std::filesystem::temp_directory_path() /
+                 fmt::format("lang_bench_{}_{}_{}_{}_{}", options.modules, options.functions_per_module, options.template_depth, options.import_fan_out, options.seed);
+        cache_folder = folder / "lang_cache/";
+        std::filesystem::create_directories(cache_folder);
+        files = CorpusGenerator(options).generate();
+        main_file = CorpusGenerator::write(files, folder);
+        if(main_file.empty())
+            throw std::runtime_error(fmt::format("Could not write the corpus to {}.", folder.string()));
+    }
+
+    std::vector<std::unique_ptr<ParsedModule>> _modules; // In the same order as files.
+
+    void parse_modules() {
+        const SilenceLog silence;
+        for(const auto& file : files) {
+            auto module = std::make_unique<ParsedModule>();
+            module->path = folder / file.name;
+            module->source = file.source;
+            module->tokens = tokenize(module->source);
+            module->parser.get_module_interface().working_directory = folder;
+            module->parser.set_cache_folder(cache_folder);
+            module->ast = module->parser.parse(module->tokens);
+            if(!module->ast)
+                throw std::runtime_error(fmt::format("Could not parse {}.", module->path.string()));
+            module->parser.write_export_interface(ModuleInterface::get_cache_filename(module->path).replace_extension(".int"));
+            _modules.push_back(std::move(module));
+        }
+    }
+};
+
+CorpusOptions default_options() { return {}; }
+
+CorpusOptions options_with_modules(size_t modules) {
+    auto options = default_options();
+    options.modules = modules;
+    return options;
+}
+
+} // namespace
+
+// Argument: Number of modules (256: About 3MB of sources).
+static void BM_Tokenizer(benchmark::State& state) {
+    const auto& project = Project::get(options_with_modules(static_cast<size_t>(state.range(0))));
+    size_t      bytes = 0;
+    size_t      tokens = 0;
+    for(auto _ : state) {
+        for(const auto& file : project.files) {
+            Tokenizer tokenizer(file.source);
+            while(tokenizer.has_more()) {
+                benchmark::DoNotOptimize(tokenizer.consume());
+                ++tokens;
+            }
+            bytes += file.source.size();
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    state.counters["tokens"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Tokenizer)->Arg(16)->Arg(256);
+
+static void BM_Parser(benchmark::State& state) {
+    auto&            project = Project::get(default_options());
+    auto&            module = project.last_module();
+    const SilenceLog silence;
+    size_t           nodes = 0;
+    for(auto _ : state) {
+        Parser parser;
+        parser.get_module_interface().working_directory = project.folder;
+        parser.set_cache_folder(project.cache_folder);
+        auto ast = parser.parse(module.tokens);
+        if(!ast) {
+            state.SkipWithError("Parsing failed.");
+            break;
+        }
+        nodes += count_nodes(ast->get_root());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * module.source.size()));
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Parser);
+
+// Tokenized while parsing, as done by the compiler.
+static void BM_Parser_Stream(benchmark::State& state) {
+    auto&            project = Project::get(default_options());
+    auto&            module = project.last_module();
+    const SilenceLog silence;
+    for(auto _ : state) {
+        Parser parser;
+        parser.get_module_interface().working_directory = project.folder;
+        parser.set_cache_folder(project.cache_folder);
+        TokenStream tokens(module.source);
+        if(!parser.parse(tokens)) {
+            state.SkipWithError("Parsing failed.");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * module.source.size()));
+}
+BENCHMARK(BM_Parser_Stream);
+
+static void BM_Codegen(benchmark::State& state) {
+    auto&            project = Project::get(default_options());
+    auto&            module = project.last_module();
+    const auto&      module_interface = module.parser.get_module_interface();
+    const SilenceLog silence;
+    size_t           instructions = 0;
+    for(auto _ : state) {
+        llvm::LLVMContext llvm_context;
+        Module            new_module{module.path.string(), &llvm_context};
+        new_module.codegen_imports(module_interface.type_imports);
+        new_module.codegen_imports(module_interface.imports);
+        if(!new_module.codegen(*module.ast)) {
+            state.SkipWithError("Codegen failed.");
+            break;
+        }
+        instructions += new_module.get_llvm_module().getInstructionCount();
+    }
+    state.counters["instructions"] = benchmark::Counter(static_cast<double>(instructions), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Codegen);
+
+static void BM_ModuleInterface_Save(benchmark::State& state) {
+    auto&       project = Project::get(default_options());
+    const auto& module_interface = project.last_module().parser.get_module_interface();
+    const auto  path = project.folder / "save_benchmark.int";
+    for(auto _ : state) {
+        if(!module_interface.save(path)) {
+            state.SkipWithError("Could not save the interface.");
+            break;
+        }
+    }
+    state.counters["exports"] = benchmark::Counter(static_cast<double>(module_interface.exports.size() + module_interface.type_exports.size()));
+}
+BENCHMARK(BM_ModuleInterface_Save);
+
+// The file contents are memoized by read_interface_file (while the file is not modified): This measures the parsing of the interface.
+static void BM_ModuleInterface_Import(benchmark::State& state) {
+    auto&            project = Project::get(default_options());
+    const auto&      module = project.last_module();
+    const auto       path = project.cache_folder / ModuleInterface::get_cache_filename(module.path).replace_extension(".int");
+    const SilenceLog silence;
+    size_t           imported = 0;
+    for(auto _ : state) {
+        ModuleInterface module_interface;
+        module_interface.working_directory = project.folder;
+        const auto [success, types, functions] = module_interface.import_module(path);
+        if(!success) {
+            state.SkipWithError("Could not import the interface.");
+            break;
+        }
+        imported += types.size() + functions.size();
+    }
+    state.counters["declarations"] = benchmark::Counter(static_cast<double>(imported), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ModuleInterface_Import);
+
+// Discovery of the whole project from its entry point, including the scan (read and tokenize) of each file. Argument: Number of modules.
+static void BM_DependencyTree(benchmark::State& state) {
+    const auto& project = Project::get(options_with_modules(static_cast<size_t>(state.range(0))));
+    for(auto _ : state) {
+        clear_resolved_dependencies();
+        DependencyTree tree;
+        if(!tree.construct({project.main_file})) {
+            state.SkipWithError("Could not construct the dependency tree.");
+            break;
+        }
+        benchmark::DoNotOptimize(tree.generate_processing_graph());
+    }
+    state.counters["files"] = benchmark::Counter(static_cast<double>(state.iterations() * project.files.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_DependencyTree)->RangeMultiplier(4)->Range(4, 256);
+
+static void BM_DependencyTree_Parallel(benchmark::State& state) {
+    const auto& project = Project::get(options_with_modules(static_cast<size_t>(state.range(0))));
+    ThreadPool  pool(std::max(1u, std::thread::hardware_concurrency()));
+    for(auto _ : state) {
+        clear_resolved_dependencies();
+        DependencyTree tree;
+        if(!tree.construct({project.main_file}, &pool)) {
+            state.SkipWithError("Could not construct the dependency tree.");
+            break;
+        }
+        benchmark::DoNotOptimize(tree.generate_processing_graph());
+    }
+    state.counters["files"] = benchmark::Counter(static_cast<double>(state.iterations() * project.files.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_DependencyTree_Parallel)->RangeMultiplier(4)->Range(4, 256)->UseRealTime();
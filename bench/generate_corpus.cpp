@@ -0,0 +1,51 @@
+#include <charconv>
+
+#include <Logger.hpp>
+#include <utils/CLIArg.hpp>
+
+#include "CorpusGenerator.hpp"
+
+// Writes a synthetic project to disk, to profile or benchmark the compiler on it (e.g. compiler <folder>/main.lang --time-report).
+int main(int argc, char* argv[]) {
+    CLIArg args;
+    args.add('m', "modules", 1, 1, "Number of modules (Default: 16).");
+    args.add('f', "functions", 1, 1, "Number of functions per module (Default: 16).");
+    args.add('d', "template-depth", 1, 1, "Nesting of the template instantiations, 0 to disable templates (Default: 2).");
+    args.add('i', "fan-out", 1, 1, "Number of imports per module (Default: 3).");
+    args.add('s', "seed", 1, 1, "Seed of the generator (Default: 1).");
+    if(!args.parse(argc, argv))
+        return 1;
+    if(args['h'].set || !args.has_default_args()) {
+        print("Usage: generate-corpus <output folder> [options]\n");
+        args.print_help();
+        return args['h'].set ? 0 : 1;
+    }
+
+    CorpusOptions options;
+    const auto    read_option = [&](char name, auto& value) {
+        if(!args[name].set)
+            return true;
+        const auto& str = args[name].value();
+        if(std::from_chars(str.data(), str.data() + str.size(), value).ec != std::errc{}) {
+            error("[generate-corpus] Invalid value '{}' for --{}.\n", str, args[name].long_name);
+            return false;
+        }
+        return true;
+    };
+    if(!read_option('m', options.modules) || !read_option('f', options.functions_per_module) || !read_option('d', options.template_depth) ||
+       !read_option('i', options.import_fan_out) || !read_option('s', options.seed))
+        return 1;
+
+    CorpusGenerator generator(options);
+    const auto      files = generator.generate();
+    const auto      main_file = CorpusGenerator::write(files, args.get_default_arg());
+    if(main_file.empty()) {
+        error("[generate-corpus] Could not write the corpus to {}.\n", args.get_default_arg());
+        return 1;
+    }
+    size_t bytes = 0;
+    for(const auto& file : files)
+        bytes += file.source.size();
+    success("[generate-corpus] Wrote {} files ({} bytes), entry point: {}.\n", files.size(), bytes, main_file.string());
+    return 0;
+}
@@ -118,7 +118,7 @@ namespace filewatch {
 		}
 
 		// Const memeber varibles don't let me implent moves nicely, if moves are really wanted std::unique_ptr should be used and move that.
-		FileWatch<T>(FileWatch<T>&&) = delete;
+		FileWatch(FileWatch<T>&&) = delete;
 		FileWatch<T>& operator=(FileWatch<T>&&) & = delete;
 
 	private:
@@ -455,7 +455,7 @@ namespace filewatch {
 				}
 			}();
 
-			const auto watch = inotify_add_watch(folder, watch_path.c_str(), IN_MODIFY | IN_CREATE | IN_DELETE);
+			const auto watch = inotify_add_watch(folder, watch_path.c_str(), IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_TO);
 			if (watch < 0) 
 			{
 				throw std::system_error(errno, std::system_category());
@@ -495,6 +495,10 @@ namespace filewatch {
 								{
 									parsed_information.emplace_back(T{ changed_file }, Event::modified);
 								}
+								else if (event->mask & IN_MOVED_TO) // Editors often save by renaming a temporary file.
+								{
+									parsed_information.emplace_back(T{ changed_file }, Event::renamed_new);
+								}
 							}
 						}
 						i += event_size + event->len;
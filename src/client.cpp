@@ -0,0 +1,52 @@
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <Logger.hpp>
+#include <compiler/ServerProtocol.hpp>
+
+// Thin client of the compile server: Forwards its arguments, working directory and standard streams to 'compiler --server',
+// and exits with the exit code of the compilation.
+// Usage: compiler-client [--socket path] <compiler arguments...>
+int main(int argc, char* argv[]) {
+#ifdef WIN32
+    error("[compiler-client] The compile server is not supported on this platform.\n");
+    return -1;
+#else
+    auto socket_path = server_protocol::get_socket_path();
+    int  first_argument = 1;
+    if(argc > 2 && std::string_view(argv[1]) == "--socket") {
+        socket_path = argv[2];
+        first_argument = 3;
+    }
+
+    server_protocol::Request request;
+    request.fds = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    request.working_directory = std::filesystem::current_path().string();
+    request.arguments.push_back(argv[0]);
+    for(int i = first_argument; i < argc; ++i)
+        request.arguments.push_back(argv[i]);
+
+    sockaddr_un address;
+    if(!server_protocol::make_address(socket_path, address)) {
+        error("[compiler-client] Socket path '{}' is too long.\n", socket_path.string());
+        return -1;
+    }
+    const auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        error("[compiler-client] Could not connect to the compile server on '{}' ({}). Start it with 'compiler --server'.\n", socket_path.string(), std::strerror(errno));
+        return -1;
+    }
+    if(!server_protocol::send_request(fd, request)) {
+        error("[compiler-client] Could not send the request to the compile server.\n");
+        return -1;
+    }
+    const auto exit_code = server_protocol::receive_exit_code(fd);
+    close(fd);
+    if(!exit_code) {
+        error("[compiler-client] Lost the connection to the compile server.\n");
+        return -1;
+    }
+    return *exit_code;
+#endif
+}
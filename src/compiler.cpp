@@ -1,39 +1,80 @@
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <charconv>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <regex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 
 #include <FileWatch.hpp>
 #include <fmt/chrono.h>
 #include <fmt/color.h>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 #include <fmt/os.h>
 #include <fmt/std.h>
 
+#include <MemoryStats.hpp>
 #include <Parser.hpp>
+#include <TemplateStats.hpp>
+#include <TokenStream.hpp>
 #include <Tokenizer.hpp>
+#include <compiler/BuildCache.hpp>
+#include <compiler/BuildManifest.hpp>
 #include <compiler/DependencyTree.hpp>
+#include <compiler/ExecutableBenchmark.hpp>
+#include <compiler/Linker.hpp>
 #include <compiler/Module.hpp>
 #include <utils/CLIArg.hpp>
+#include <utils/Hash.hpp>
+#include <utils/MappedFile.hpp>
+#include <utils/TemporaryFile.hpp>
+#include <utils/ThreadPool.hpp>
+#include <utils/MemoryUsage.hpp>
+#include <utils/TimeTrace.hpp>
 
 #include <het_unordered_map.hpp>
 
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Bitcode/BitcodeWriterPass.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/MCSubtargetInfo.h>
 #include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/Host.h>
-#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/Utils/Cloning.h>
 
 #include <jit/LLVMJIT.hpp>
 
-#include <string_utils.hpp>
+#ifndef WIN32
+#include <compiler/ServerProtocol.hpp>
+#include <csignal>
+#include <sys/wait.h>
+#endif
 
 CLIArg args;
 
@@ -42,75 +83,436 @@ std::set<std::filesystem::path> input_files;     // Original files passed to the
 std::set<std::filesystem::path> object_files;    // List of all generated object files for linking.
 
 std::set<std::filesystem::path> processed_files; // Cleared at the start of a run, makes sure we don't end up in a loop. FIXME: Shouldn't be useful anymore.
+std::mutex                      files_mutex;     // Guards object_files and processed_files when files are processed in parallel.
+std::set<std::filesystem::path> watched_files;   // Files of the dependency graph and candidates of its imports, monitored in watch mode.
+
+void add_object_file(const std::filesystem::path& path) {
+    std::lock_guard lock(files_mutex);
+    object_files.insert(path);
+}
+
+void mark_as_processed(const std::filesystem::path& path) {
+    std::lock_guard lock(files_mutex);
+    processed_files.insert(path);
+}
+
+bool is_processed(const std::filesystem::path& path) {
+    std::lock_guard lock(files_mutex);
+    return processed_files.contains(path);
+}
+
+// Part of the cache keys: Results of another version of the compiler are never reused.
+constexpr std::string_view compiler_version = "0.0.1";
+
+// The version isn't bumped by every change to the code generation: Results of another build of the compiler are never reused either.
+// Hash of the compiler executable, computed on first use. Hashing it takes a while, it is remembered in the cache folder along with
+// the size and modification time of the executable.
+uint64_t get_compiler_build_id() {
+    static const uint64_t build_id = [] {
+        const auto            path = llvm::sys::fs::getMainExecutable(nullptr, reinterpret_cast<void*>(&get_compiler_build_id));
+        BuildManifest::Record executable_status;
+        if(path.empty() || !BuildManifest::read_file_status(path, executable_status)) {
+            warn("[compiler] Could not find the compiler executable: Cached results of other builds of the compiler may be reused.\n");
+            return uint64_t{0};
+        }
+        const auto memo_path = cache_folder / "compiler_id";
+        uintmax_t  size = 0;
+        int64_t    time = 0;
+        uint64_t   hash = 0;
+        if(std::ifstream memo(memo_path); memo >> size >> time >> hash && size == executable_status.source_size && time == executable_status.source_time)
+            return hash;
+        MappedFile executable;
+        if(!executable.open(path)) {
+            warn("[compiler] Could not read the compiler executable: Cached results of other builds of the compiler may be reused.\n");
+            return uint64_t{0};
+        }
+        hash = hash_bytes(executable.view());
+        std::error_code ec;
+        std::filesystem::create_directories(cache_folder, ec);
+        const auto temporary_path = make_temporary_path(memo_path);
+        if(std::ofstream memo(temporary_path); memo << executable_status.source_size << ' ' << executable_status.source_time << ' ' << hash)
+            memo.close();
+        commit_temporary_file(temporary_path, memo_path);
+        return hash;
+    }();
+    return build_id;
+}
+
+// Link Time Optimization mode, selects between object files and bitcode.
+LinkOptions link_options;
+
+// -O0 skips the optimization pipeline entirely, for fast development builds.
+llvm::OptimizationLevel optimization_level = llvm::OptimizationLevel::O3;
+
+std::optional<llvm::OptimizationLevel> parse_optimization_level(std::string_view str) {
+    if(str == "0")
+        return llvm::OptimizationLevel::O0;
+    if(str == "1")
+        return llvm::OptimizationLevel::O1;
+    if(str == "2")
+        return llvm::OptimizationLevel::O2;
+    if(str == "3")
+        return llvm::OptimizationLevel::O3;
+    if(str == "s")
+        return llvm::OptimizationLevel::Os;
+    return std::nullopt;
+}
+
+llvm::CodeGenOpt::Level get_codegen_optimization_level() {
+    switch(optimization_level.getSpeedupLevel()) {
+        case 0: return llvm::CodeGenOpt::None;
+        case 1: return llvm::CodeGenOpt::Less;
+        case 2: return llvm::CodeGenOpt::Default;
+        default: return llvm::CodeGenOpt::Aggressive;
+    }
+}
+
+// Registers the native target on first use, throws if it is not available.
+const llvm::Target* get_llvm_target() {
+    static std::once_flag      llvm_target_initialized; // Target registration is not thread-safe.
+    static const llvm::Target* target = nullptr;
+    static std::string         error_str;
+    std::call_once(llvm_target_initialized, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmParser();
+        llvm::InitializeNativeTargetAsmPrinter();
+        target = llvm::TargetRegistry::lookupTarget(llvm::sys::getDefaultTargetTriple(), error_str);
+    });
+    if(!target)
+        throw Exception(fmt::format("Could not lookup target: {}.\n", error_str));
+    return target;
+}
+
+// Resolved by resolve_target_options: 'native' is replaced by the name and features of the host CPU.
+std::string target_cpu = "generic";
+std::string target_features;
+
+// Target setup is done once per worker thread: A TargetMachine is not safe to use from several threads at once.
+// It is created again if the target options changed since (the compile server creates it before knowing the options of its requests).
+llvm::TargetMachine* get_target_machine() {
+    thread_local std::unique_ptr<llvm::TargetMachine> target_machine;
+    thread_local std::string                          target_machine_options;
+    auto                                              options_str = fmt::format("{} {} {}", target_cpu, target_features, optimization_level.getSpeedupLevel());
+    if(!target_machine || target_machine_options != options_str) {
+        target_machine_options = std::move(options_str);
+        llvm::TargetOptions options;
+        target_machine.reset(get_llvm_target()->createTargetMachine(llvm::sys::getDefaultTargetTriple(), target_cpu, target_features, options, llvm::None, llvm::None,
+                                                                    get_codegen_optimization_level()));
+        if(!target_machine)
+            throw Exception(fmt::format("Could not create target machine for {} (CPU: {}, Features: {}).\n", llvm::sys::getDefaultTargetTriple(), target_cpu, target_features));
+    }
+    return target_machine.get();
+}
+
+// Records the target on each function, like clang does: The optimizer and link time code generation then target the same CPU.
+void apply_target_attributes(llvm::Module& module) {
+    for(auto& function : module) {
+        if(function.isDeclaration())
+            continue;
+        function.addFnAttr("target-cpu", target_cpu);
+        if(!target_features.empty())
+            function.addFnAttr("target-features", target_features);
+    }
+}
+
+// Returns true on success
+bool resolve_target_options() {
+    if(args["target-cpu"].set)
+        target_cpu = args["target-cpu"].value();
+    std::vector<std::string> features;
+    if(target_cpu == "native") {
+        target_cpu = llvm::sys::getHostCPUName().str();
+        llvm::StringMap<bool> host_features;
+        if(llvm::sys::getHostCPUFeatures(host_features))
+            for(const auto& feature : host_features)
+                features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        std::sort(features.begin(), features.end()); // Part of the cache keys.
+    }
+    // Explicit features are applied last, and take precedence over the ones of the host.
+    if(args["target-features"].set)
+        features.push_back(args["target-features"].value());
+    target_features = fmt::format("{}", fmt::join(features, ","));
+
+    const auto target_machine = get_target_machine();
+    if(!target_machine->getMCSubtargetInfo()->isCPUStringValid(target_cpu)) {
+        error("Unknown target CPU '{}'.\n", target_cpu);
+        return false;
+    }
+    return true;
+}
+
+// Options affecting the generated code, whatever the LTO mode.
+std::string get_target_flags() {
+    return fmt::format("{} O{}/{} cpu={} features={}", llvm::sys::getDefaultTargetTriple(), optimization_level.getSpeedupLevel(), optimization_level.getSizeLevel(),
+                       target_cpu, target_features);
+}
+
+// Options affecting the generated object files, part of the cache keys.
+std::string get_codegen_flags() {
+    return fmt::format("{} lto={}", get_target_flags(), to_string(link_options.lto));
+}
 
+// Runs the optimization pipeline matching the optimization level and the LTO mode. Per-pass timings are appended to timings, if not null.
+void optimize_module(llvm::Module& module, llvm::TargetMachine* target_machine, LTOMode lto, std::string* timings) {
+    if(optimization_level == llvm::OptimizationLevel::O0)
+        return;
+    TimeTraceScope                     trace_scope("Optimize", module.getName().str());
+    std::string                        timings_report;
+    llvm::raw_string_ostream           timings_stream(timings_report);
+    llvm::PassInstrumentationCallbacks instrumentation;
+    llvm::TimePassesHandler            time_passes(timings != nullptr);
+    time_passes.setOutStream(timings_stream);
+    time_passes.registerCallbacks(instrumentation);
+    // Each pass is a span of the time trace. Passes nest (e.g. function passes run by an adaptor).
+    std::vector<TimeTrace::Event> running_passes;
+    if(TimeTrace::instance().is_enabled()) {
+        instrumentation.registerBeforeNonSkippedPassCallback([&](llvm::StringRef pass, llvm::Any) {
+            running_passes.push_back(TimeTrace::Event{.name = pass.str(), .detail = module.getName().str(), .start = TimeTrace::instance().now()});
+        });
+        const auto end_pass = [&] {
+            auto event = std::move(running_passes.back());
+            running_passes.pop_back();
+            event.duration = TimeTrace::instance().now() - event.start;
+            TimeTrace::instance().add(std::move(event));
+        };
+        instrumentation.registerAfterPassCallback([=](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses&) { end_pass(); });
+        instrumentation.registerAfterPassInvalidatedCallback([=](llvm::StringRef, const llvm::PreservedAnalyses&) { end_pass(); });
+    }
+
+    llvm::LoopAnalysisManager     loop_analysis_manager;
+    llvm::FunctionAnalysisManager function_analysis_manager;
+    llvm::CGSCCAnalysisManager    cgscc_analysis_manager;
+    llvm::ModuleAnalysisManager   module_analysis_manager;
+    llvm::PassBuilder             pass_builder(target_machine, llvm::PipelineTuningOptions(), llvm::None, &instrumentation);
+    pass_builder.registerModuleAnalyses(module_analysis_manager);
+    pass_builder.registerCGSCCAnalyses(cgscc_analysis_manager);
+    pass_builder.registerFunctionAnalyses(function_analysis_manager);
+    pass_builder.registerLoopAnalyses(loop_analysis_manager);
+    pass_builder.crossRegisterProxies(loop_analysis_manager, function_analysis_manager, cgscc_analysis_manager, module_analysis_manager);
+
+    llvm::ModulePassManager pass_manager;
+    switch(lto) {
+        case LTOMode::None: pass_manager = pass_builder.buildPerModuleDefaultPipeline(optimization_level); break;
+        case LTOMode::Thin: pass_manager = pass_builder.buildThinLTOPreLinkDefaultPipeline(optimization_level); break;
+        case LTOMode::Full: pass_manager = pass_builder.buildLTOPreLinkDefaultPipeline(optimization_level); break;
+    }
+    pass_manager.run(module, module_analysis_manager);
+
+    time_passes.print();
+    if(timings)
+        *timings += timings_stream.str();
+}
+
+// Hash of the interface (.int) of each processed module, including the interfaces of its own dependencies.
+// Dependents only have to be re-processed when it changes, not on every modification of the module.
+std::unordered_map<std::filesystem::path, uint64_t> interface_hashes;
+
+void set_interface_hash(const std::filesystem::path& path, uint64_t hash) {
+    std::lock_guard lock(files_mutex);
+    interface_hashes[path] = hash;
+}
+
+std::optional<uint64_t> get_interface_hash(const std::filesystem::path& path) {
+    std::lock_guard lock(files_mutex);
+    if(auto it = interface_hashes.find(path); it != interface_hashes.end())
+        return it->second;
+    return std::nullopt;
+}
+
+// Content-addressed store of object and interface files, shared between runs (and possibly other checkouts).
+std::unique_ptr<BuildCache> build_cache;
+
+// Last processing of each module, persisted in the cache folder.
+BuildManifest build_manifest;
+
+// Returns true on success
+bool copy_file_atomically(const std::filesystem::path& from, const std::filesystem::path& to) {
+    std::error_code ec;
+    const auto      temporary = make_temporary_path(to);
+    std::filesystem::copy_file(from, temporary, std::filesystem::copy_options::overwrite_existing, ec);
+    return !ec && commit_temporary_file(temporary, to);
+}
+
+// Written by precompile_stdlib next to the precompiled modules.
+const std::filesystem::path precompiled_flags_path = std::filesystem::path(LANG_STDLIB_PRECOMPILED_FOLDER) / "target_flags.txt";
+
+// Standard library modules are precompiled with the compiler (see precompile_stdlib): Their interface and object file (.o, or .bc
+// for LTO) are used as is instead of being compiled into each project. Modules exporting templates have no precompiled object,
+// their specializations are generated by the importing modules.
+// They are precompiled with the default code generation options: With other ones, they are compiled (and cached) like the project modules.
+std::optional<std::filesystem::path> find_precompiled_object(const std::filesystem::path& path, std::string_view extension) {
+    static const bool same_target_flags = [] {
+        std::ifstream file(precompiled_flags_path);
+        std::string   flags;
+        std::getline(file, flags);
+        if(file && flags != get_target_flags())
+            print_subtle(" * Standard library precompiled for '{}', compiling it for '{}'.\n", flags, get_target_flags());
+        return file && flags == get_target_flags();
+    }();
+    if(!same_target_flags || input_files.contains(path))
+        return std::nullopt;
+    const auto relative = path.lexically_relative(stdlib_folder);
+    if(relative.empty() || *relative.begin() == "..")
+        return std::nullopt;
+    auto object = std::filesystem::path(LANG_STDLIB_PRECOMPILED_FOLDER);
+    object += ModuleInterface::get_cache_filename(path).replace_extension(extension);
+    if(!std::filesystem::exists(object))
+        return std::nullopt;
+    return object;
+}
+
+// Importing modules read the interface from the precompiled folder: It is shared by all projects (and preloaded by the compile server).
+// Returns true on success
+bool import_precompiled_interface(const std::filesystem::path& path, const std::filesystem::path& object) {
+    const auto precompiled_interface = std::filesystem::path(object).replace_extension(".int");
+    set_interface_path(path, precompiled_interface);
+    const auto interface_hash = hash_file(precompiled_interface);
+    const auto object_hash = hash_file(object);
+    if(!interface_hash || !object_hash) {
+        error("[compiler] Could not read precompiled module {}.\n", object.string());
+        return false;
+    }
+    // The interface doesn't hold the default values of type members: Any rebuild of the module is considered an interface change.
+    set_interface_hash(path, Hasher().add(*interface_hash).add(*object_hash).value());
+    print_subtle(" * Using precompiled standard library module for {}.\n", path.string());
+    mark_as_processed(path);
+    return true;
+}
+
+// Nodes of the parsed ASTs by type, across files (--mem-stats). Sizes exclude the members of derived node types.
+struct ASTMemory {
+    size_t  count = 0;
+    int64_t bytes = 0;
+};
+std::map<AST::Node::Type, ASTMemory> ast_memory;
+
+void record_ast_memory(const AST::Node& root) {
+    std::map<AST::Node::Type, ASTMemory> file_memory;
+    const auto                           visit = [&](const auto& self, const AST::Node& node) -> void {
+        auto& memory = file_memory[node.type];
+        ++memory.count;
+        memory.bytes += static_cast<int64_t>(sizeof(AST::Node) + node.children.capacity() * sizeof(AST::Node*));
+        for(const auto child : node.children)
+            self(self, *child);
+    };
+    visit(visit, root);
+    std::lock_guard lock(files_mutex);
+    for(const auto& [type, memory] : file_memory) {
+        ast_memory[type].count += memory.count;
+        ast_memory[type].bytes += memory.bytes;
+    }
+}
+
+// scan: Source of the file read by the DependencyTree, if available.
 // Returns true on success
-bool handle_file(const std::filesystem::path& path) {
-    if(processed_files.contains(path))
+bool handle_file(const std::filesystem::path& path, const std::vector<std::filesystem::path>& dependencies, std::unique_ptr<DependencyTree::Scan> scan) {
+    if(is_processed(path))
+        return true;
+    if(const auto precompiled = find_precompiled_object(path, link_options.lto == LTOMode::None ? ".o" : ".bc")) {
+        if(!import_precompiled_interface(path, *precompiled))
+            return false;
+        add_object_file(*precompiled);
         return true;
-    if(!std::filesystem::exists(path)) {
-        throw Exception(fmt::format("Requested file {} does not exist.", path));
     }
     auto filename = path.stem();
 
+    // Unmodified since the last run: Its hash is known without reading it.
+    const auto                        manifest_record = build_manifest.find_unchanged(path);
+    BuildManifest::Record             record;
+    std::shared_ptr<const SourceFile> source;
+    const auto                        read_source = [&] {
+        source = SourceManager::instance().load(path);
+        if(!source)
+            throw Exception(fmt::format("[compiler::handle_file] Couldn't open file '{}' (Running from {}).\n", path.string(), std::filesystem::current_path().string()));
+    };
+    if(scan) {
+        record.source_size = scan->file_status.source_size;
+        record.source_time = scan->file_status.source_time;
+        record.source_hash = scan->file_status.source_hash;
+        record.probes = std::move(scan->file_status.probes);
+        source = std::move(scan->source);
+    } else if(manifest_record) {
+        record.source_size = manifest_record->source_size;
+        record.source_time = manifest_record->source_time;
+        record.source_hash = manifest_record->source_hash;
+        record.probes = manifest_record->probes;
+    } else {
+        if(!std::filesystem::exists(path)) {
+            throw Exception(fmt::format("Requested file {} does not exist.", path));
+        }
+        BuildManifest::read_file_status(path, record);
+        read_source();
+        record.source_hash = hash_bytes(source->content());
+    }
+
+    // The result only depends on the source, the interfaces of the dependencies and the compiler itself:
+    // Timestamps are irrelevant, and modifying the implementation of a dependency doesn't invalidate this module.
+    const auto source_hash = record.source_hash;
+    Hasher     inputs_hasher;
+    // The file name ends up in the object file, but not the full path: Identical checkouts can share their results.
+    inputs_hasher.add(compiler_version).add(get_compiler_build_id()).add(LLVM_VERSION_STRING).add(get_codegen_flags()).add(filename.string()).add(source_hash);
+    for(const auto& dep : dependencies) {
+        const auto dep_interface_hash = get_interface_hash(dep);
+        if(!dep_interface_hash) {
+            error("[compiler] Dependency {} of {} has not been processed.\n", dep.string(), path.string());
+            return false;
+        }
+        inputs_hasher.add(*dep_interface_hash);
+    }
+    const auto inputs_hash = inputs_hasher.value();
+    record.inputs_hash = inputs_hash;
+    record.dependencies = dependencies;
+
     auto cache_filename = ModuleInterface::get_cache_filename(path);
     auto o_filepath = cache_folder;
     o_filepath += cache_filename.replace_extension(".o");
-    if(!args['t'].set && !args['a'].set && !args['i'].set && !args['b'].set) {
-        if(!args["bypass-cache"].set && std::filesystem::exists(o_filepath)) {
-            const auto o_file_last_write = std::filesystem::last_write_time(o_filepath);
-            if(o_file_last_write > std::filesystem::last_write_time(path)) {
-                print_subtle(" * Using cached compilation result for {}.\n", path.string());
-                // Check if any dependency is newer than our cached result.
-                ModuleInterface module_interface;
-                module_interface.working_directory = path.parent_path();
-                module_interface.import_module(o_filepath.replace_extension(".int"));
-                bool updated_deps = false;
-                for(const auto& dep : module_interface.dependencies) {
-                    auto dep_path = std::filesystem::absolute(module_interface.resolve_dependency(dep));
-                    if(o_file_last_write < std::filesystem::last_write_time(dep_path)) {
-                        updated_deps = true;
-                        break;
-                    }
-                }
-                if(!updated_deps) {
-                    object_files.insert(o_filepath);
-                    processed_files.insert(path);
-                    return true;
-                }
-                // Some dependencies were re-generated, continue processing anyway.
-                print_subtle(" * * Cache for {} is outdated, re-processing...\n", path.string());
+    auto interface_filepath = o_filepath;
+    interface_filepath.replace_extension(".int");
+    const bool use_cache = !args['t'].set && !args['a'].set && !args['i'].set && !args['b'].set;
+    if(use_cache && !args["bypass-cache"].set) {
+        TimeTraceScope trace_scope("Cache lookup", path.string());
+        // Same inputs as the last run, and its results are still in the store: Nothing to do. The entry is still touched so it isn't evicted before linking.
+        if(const auto object = manifest_record && manifest_record->inputs_hash == inputs_hash ? build_cache->touch(inputs_hash) : std::nullopt) {
+            print_subtle(" * Using cached compilation result for {}.\n", path.string());
+            set_interface_hash(path, manifest_record->interface_hash);
+            add_object_file(*object);
+            mark_as_processed(path);
+            build_manifest.mark_as_up_to_date();
+            return true;
+        }
+        if(const auto entry = build_cache->lookup(inputs_hash)) {
+            // Importing modules expect the interface in the local cache folder.
+            if(!copy_file_atomically(entry->interface, interface_filepath)) {
+                error("[compiler] Could not copy cached interface {} to {}.\n", entry->interface.string(), interface_filepath.string());
+                return false;
             }
+            print_subtle(" * Using cached compilation result for {}.\n", path.string());
+            set_interface_hash(path, entry->interface_hash);
+            add_object_file(entry->object);
+            mark_as_processed(path);
+            record.interface_hash = entry->interface_hash;
+            record.object = entry->object;
+            build_manifest.update(path, std::move(record));
+            return true;
         }
     }
+    if(!source)
+        read_source();
     print("Processing {}... \n", path.string());
     const auto total_start = std::chrono::high_resolution_clock::now();
 
-    std ::ifstream input_file(path);
-    if(!input_file)
-        throw Exception(fmt::format("[compiler::handle_file] Couldn't open file '{}' (Running from {}).\n", path.string(), std::filesystem::current_path().string()));
-    std::string source{(std::istreambuf_iterator<char>(input_file)), std::istreambuf_iterator<char>()};
-
-    const auto tokenizing_start = std::chrono::high_resolution_clock::now();
-
-    std::vector<Token> tokens;
-    try {
-        Tokenizer tokenizer(source);
-        while(tokenizer.has_more())
-            tokens.push_back(tokenizer.consume());
-    } catch(const Exception& e) {
-        e.display();
-        return false;
-    }
-
-    const auto tokenizing_end = std::chrono::high_resolution_clock::now();
-
     // Print tokens
     if(args['t'].set) {
-        int i = 0;
-        for(const auto& t : tokens) {
-            fmt::print("  {}", t);
-            if(++i % 6 == 0)
-                fmt::print("\n");
+        try {
+            Tokenizer tokenizer(*source);
+            for(int i = 1; tokenizer.has_more(); ++i) {
+                fmt::print("  {}", tokenizer.consume());
+                if(i % 6 == 0)
+                    fmt::print("\n");
+            }
+        } catch(const Exception& e) {
+            e.display();
+            return false;
         }
         fmt::print("\n");
         return true;
@@ -119,12 +521,34 @@ bool handle_file(const std::filesystem::path& path) {
     const auto parsing_start = std::chrono::high_resolution_clock::now();
     Parser     parser;
     parser.get_module_interface().working_directory = path.parent_path();
-    parser.set_source(source);
     parser.set_cache_folder(cache_folder);
-    auto       ast = parser.parse(tokens);
+    std::optional<AST> ast;
+    {
+        // Tokenized while parsing.
+        TimeTraceScope trace_scope("Parse", path.string());
+        TokenStream    tokens(*source);
+        ast = parser.parse(tokens);
+    }
     const auto parsing_end = std::chrono::high_resolution_clock::now();
+    if(ast.has_value() && args["mem-stats"].set)
+        record_ast_memory(ast->get_root());
     if(ast.has_value()) {
         parser.write_export_interface(cache_filename.replace_extension(".int"));
+        const auto interface_file_hash = hash_file(interface_filepath);
+        if(!interface_file_hash) {
+            error("[compiler] Could not read interface file {}.\n", interface_filepath.string());
+            return false;
+        }
+        // The interface doesn't hold templates implementations nor the default values of type members:
+        // Modules exporting these are conservatively considered to change their interface with every modification.
+        const auto& module_interface = parser.get_module_interface();
+        const auto  exports_templates = std::any_of(module_interface.exports.begin(), module_interface.exports.end(), [](const auto& f) { return f->is_templated(); });
+        Hasher      interface_hasher;
+        interface_hasher.add(*interface_file_hash).add(!module_interface.type_exports.empty() || exports_templates ? source_hash : 0);
+        for(const auto& dep : dependencies)
+            interface_hasher.add(*get_interface_hash(dep));
+        const auto interface_hash = interface_hasher.value();
+        set_interface_hash(path, interface_hash);
         if(args['a'].set) {
             if(args['o'].set && args['o'].has_value()) {
                 auto out = fmt::output_file(args['o'].value());
@@ -140,17 +564,22 @@ bool handle_file(const std::filesystem::path& path) {
             const auto                         codegen_start = std::chrono::high_resolution_clock::now();
             std::unique_ptr<llvm::LLVMContext> llvm_context(new llvm::LLVMContext());
             Module                             new_module{path.string(), llvm_context.get()};
-            new_module.codegen_imports(parser.get_module_interface().type_imports);
-            new_module.codegen_imports(parser.get_module_interface().imports);
-            auto result = new_module.codegen(*ast);
+            llvm::Value*                       result = nullptr;
+            {
+                TimeTraceScope trace_scope("Codegen", path.string());
+                new_module.codegen_imports(parser.get_module_interface().type_imports);
+                new_module.codegen_imports(parser.get_module_interface().imports);
+                result = new_module.codegen(*ast);
+            }
             if(!result) {
                 warn("LLVM Codegen returned nullptr. No object file generated for '{}'.\n", path);
-                processed_files.insert(path);
+                mark_as_processed(path);
                 return true;
             }
             if(llvm::verifyModule(new_module.get_llvm_module(), &llvm::errs()))
                 throw Exception("\nErrors in LLVM Module.\n");
-            const auto codegen_end = std::chrono::high_resolution_clock::now();
+            const memory_stats::Allocation module_allocation(memory_stats::llvm_modules, new_module.get_llvm_module().getInstructionCount());
+            const auto                    codegen_end = std::chrono::high_resolution_clock::now();
 
             const auto write_ir_start = std::chrono::high_resolution_clock::now();
             if(args['i'].set) {
@@ -183,24 +612,15 @@ bool handle_file(const std::filesystem::path& path) {
             // Generate Object file
             if(args['b'].set && args['o'].set)
                 o_filepath = args['o'].value();
+            else if(use_cache)
+                o_filepath = build_cache->temporary_object_path(inputs_hash);
 
             auto target_triple = llvm::sys::getDefaultTargetTriple();
-            llvm::InitializeNativeTarget();
-            llvm::InitializeNativeTargetAsmParser();
-            llvm::InitializeNativeTargetAsmPrinter();
-            std::string error_str;
-            auto        target = llvm::TargetRegistry::lookupTarget(target_triple, error_str);
-            if(!target)
-                throw Exception(fmt::format("Could not lookup target: {}.\n", error_str));
-            auto cpu = "generic";
-            auto features = "";
-
-            llvm::TargetOptions opt;
-            auto                reloc_model = llvm::Optional<llvm::Reloc::Model>();
-            auto                target_machine = target->createTargetMachine(target_triple, cpu, features, opt, reloc_model);
+            auto target_machine = get_target_machine();
 
             new_module.get_llvm_module().setDataLayout(target_machine->createDataLayout());
             new_module.get_llvm_module().setTargetTriple(target_triple);
+            apply_target_attributes(new_module.get_llvm_module());
 
             std::error_code      error_code;
             llvm::raw_fd_ostream dest(o_filepath.string(), error_code, llvm::sys::fs::OF_None);
@@ -208,26 +628,44 @@ bool handle_file(const std::filesystem::path& path) {
             if(error_code)
                 throw Exception(fmt::format("Could not open file '{}': {}.\n", o_filepath.string(), error_code.message()));
 
+            std::string pass_timings;
+            optimize_module(new_module.get_llvm_module(), target_machine, link_options.lto, args["time-passes"].set ? &pass_timings : nullptr);
+            print("{}", pass_timings);
+
+            // Code generation still requires the legacy pass manager.
             llvm::legacy::PassManager passManager;
-            llvm::PassManagerBuilder  passManagerBuilder;
             auto                      file_type = llvm::CGFT_ObjectFile;
-            passManagerBuilder.OptLevel = 3;
-            passManagerBuilder.PrepareForLTO = true;
-            passManagerBuilder.populateModulePassManager(passManager);
 
-            if(target_machine->addPassesToEmitFile(passManager, dest, nullptr, file_type)) {
+            // With LTO, the linker generates the machine code from the bitcode.
+            if(link_options.lto == LTOMode::Thin)
+                passManager.add(llvm::createWriteThinLTOBitcodePass(dest));
+            else if(link_options.lto == LTOMode::Full)
+                passManager.add(llvm::createBitcodeWriterPass(dest));
+            else if(target_machine->addPassesToEmitFile(passManager, dest, nullptr, file_type)) {
                 error("Target Machine (Target Triple: {}) can't emit a file of this type.\n", target_triple);
                 return false;
             }
 
-            passManager.run(new_module.get_llvm_module());
-            object_files.insert(o_filepath);
-            dest.flush();
+            {
+                TimeTraceScope trace_scope("Object generation", path.string());
+                passManager.run(new_module.get_llvm_module());
+            }
+            dest.close();
+            if(use_cache) {
+                const auto entry = build_cache->insert(inputs_hash, o_filepath, interface_filepath, interface_hash);
+                if(!entry)
+                    return false;
+                o_filepath = entry->object;
+                record.interface_hash = interface_hash;
+                record.object = o_filepath;
+                build_manifest.update(path, std::move(record));
+            }
+            add_object_file(o_filepath);
             success("Wrote object file '{}' (Target Triple: {}).\n", o_filepath.string(), target_triple);
             if(args['b'].set)
                 return true;
 
-            if(args['j'].set) {
+            if(args["jit"].set) {
                 // Quick Test JIT (TODO: Remove?)
                 lang::LLVMJIT jit;
                 auto          return_value = jit.run(std::move(new_module.get_llvm_module_ptr()), std::move(llvm_context));
@@ -237,82 +675,492 @@ bool handle_file(const std::filesystem::path& path) {
             const auto object_gen_end = std::chrono::high_resolution_clock::now();
             const auto total_end = std::chrono::high_resolution_clock::now();
 
-            print(" {:<12} | {:<12} | {:<12} | {:<12} | {:<12} | {:<12} \n", fmt::styled("Tokenizer", fmt::fg(fmt::color::aquamarine)),
-                  fmt::styled("Parser", fmt::fg(fmt::color::aquamarine)), fmt::styled("LLVMCodegen", fmt::fg(fmt::color::aquamarine)),
+            print(" {:<12} | {:<12} | {:<12} | {:<12} | {:<12} \n", fmt::styled("Parser", fmt::fg(fmt::color::aquamarine)),
+                  fmt::styled("LLVMCodegen", fmt::fg(fmt::color::aquamarine)),
                   fmt::styled("IR", fmt::fg(fmt::color::aquamarine)), fmt::styled("ObjectGen", fmt::fg(fmt::color::aquamarine)),
                   fmt::styled("Total", fmt::fg(fmt::color::aquamarine)));
-            print(" {:^12.2} | {:^12.2} | {:^12.2} | {:^12.2} | {:^12.2} | {:^12.2} \n", std::chrono::duration<double, std::milli>(tokenizing_end - tokenizing_start),
-                  std::chrono::duration<double, std::milli>(parsing_end - parsing_start), std::chrono::duration<double, std::milli>(codegen_end - codegen_start),
+            print(" {:^12.2} | {:^12.2} | {:^12.2} | {:^12.2} | {:^12.2} \n", std::chrono::duration<double, std::milli>(parsing_end - parsing_start), std::chrono::duration<double, std::milli>(codegen_end - codegen_start),
                   std::chrono::duration<double, std::milli>(write_ir_end - write_ir_start), std::chrono::duration<double, std::milli>(object_gen_end - object_gen_start),
                   std::chrono::duration<double, std::milli>(total_end - total_start));
         } catch(const std::exception& e) {
             error("Exception: {}", e.what());
             return false;
         }
-        processed_files.insert(path);
+        mark_as_processed(path);
         return true;
     }
     return false;
 }
 
+// Number of worker threads requested by the user, 1 if files should be processed serially.
+size_t get_jobs_count() {
+    // Dumping intermediate results only makes sense for a single file, and they are written directly to stdout.
+    if(!args['j'].set || args['t'].set || args['a'].set || args['i'].set || args['b'].set || args["jit"].set)
+        return 1;
+    size_t      jobs = 1;
+    const auto& value = args['j'].value();
+    if(auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), jobs); ec != std::errc{} || ptr != value.data() + value.size()) {
+        warn("[compiler] Invalid number of jobs '{}', processing files serially.\n", value);
+        return 1;
+    }
+    if(jobs == 0)
+        return std::max(1u, std::thread::hardware_concurrency());
+    return jobs;
+}
+
+// Duration of the last processing of each file, used to estimate the critical path of the following runs (watch mode).
+std::unordered_map<std::filesystem::path, double> last_processing_durations;
+
+double estimate_processing_cost(const std::filesystem::path& path) {
+    std::lock_guard lock(files_mutex);
+    if(auto it = last_processing_durations.find(path); it != last_processing_durations.end())
+        return it->second;
+    // Unknown file: Assume an average cost.
+    if(last_processing_durations.empty())
+        return 1.0;
+    double total = 0.0;
+    for(const auto& [p, duration] : last_processing_durations)
+        total += duration;
+    return total / last_processing_durations.size();
+}
+
 // Returns true on success
-bool link(const std::string& final_outputfile) {
+bool timed_handle_file(const std::filesystem::path& path, const std::vector<std::filesystem::path>& dependencies, std::unique_ptr<DependencyTree::Scan> scan) {
+    TimeTraceScope trace_scope("Process file", path.string());
+    const auto     start = std::chrono::high_resolution_clock::now();
+    const auto     r = handle_file(path, dependencies, std::move(scan));
+    const auto end = std::chrono::high_resolution_clock::now();
+    std::lock_guard lock(files_mutex);
+    last_processing_durations[path] = std::chrono::duration<double, std::milli>(end - start).count();
+    return r;
+}
+
+std::vector<std::filesystem::path> get_dependencies(const DependencyTree::ProcessingGraph& graph, size_t node) {
+    std::vector<std::filesystem::path> dependencies;
+    dependencies.reserve(graph.dependencies[node].size());
+    for(const auto dependency : graph.dependencies[node])
+        dependencies.push_back(graph.files[dependency]);
+    return dependencies;
+}
+
+// Processes each file as soon as all of its dependencies are, favoring the critical path, using the worker threads of the pool (serially if null).
+// Each file is handled in isolation (own Parser and LLVMContext) and its log is buffered, then printed following graph.order,
+// so the output doesn't depend on the actual scheduling.
+// Returns true on success
+bool process_graph(DependencyTree& tree, const DependencyTree::ProcessingGraph& graph, ThreadPool* pool) {
+    if(!pool) {
+        for(const auto node : graph.order)
+            if(!timed_handle_file(graph.files[node], get_dependencies(graph, node), tree.take_scan(graph.files[node])))
+                return false;
+        return true;
+    }
+
+    struct Result {
+        bool        done = false;
+        bool        success = false;
+        std::string log;
+    };
+    std::vector<Result> results(graph.size());
+
+    const auto compare = [&graph](size_t lhs, size_t rhs) { return graph.lower_priority(lhs, rhs); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(compare)> ready(compare);
+    auto                                                                remaining_dependencies = graph.dependencies_count;
+    for(size_t i = 0; i < graph.size(); ++i)
+        if(remaining_dependencies[i] == 0)
+            ready.push(i);
+
+    std::mutex              finished_mutex;
+    std::condition_variable finished_condition;
+    std::vector<size_t>     finished;
+
+    const auto jobs = pool->size();
+    size_t     running = 0;
+    size_t     next_log = 0;
+    bool       success = true;
+    while(true) {
+        // Stop scheduling new files after the first error, but let the running ones finish.
+        while(success && running < jobs && !ready.empty()) {
+            const auto node = ready.top();
+            ready.pop();
+            ++running;
+            pool->submit([&, node] {
+                std::string log;
+                bool        r = false;
+                log_buffer = &log;
+                try {
+                    r = timed_handle_file(graph.files[node], get_dependencies(graph, node), tree.take_scan(graph.files[node]));
+                } catch(const Exception& e) {
+                    e.display();
+                } catch(const std::exception& e) { error("Exception: {}\n", e.what()); }
+                log_buffer = nullptr;
+                {
+                    std::lock_guard lock(finished_mutex);
+                    results[node].success = r;
+                    results[node].log = std::move(log);
+                    finished.push_back(node);
+                }
+                finished_condition.notify_one();
+            });
+        }
+        if(running == 0)
+            break;
+
+        std::vector<size_t> batch;
+        {
+            std::unique_lock lock(finished_mutex);
+            finished_condition.wait(lock, [&] { return !finished.empty(); });
+            std::swap(batch, finished);
+        }
+        for(const auto node : batch) {
+            --running;
+            results[node].done = true;
+            if(!results[node].success) {
+                success = false;
+                continue;
+            }
+            for(const auto dependent : graph.dependents[node])
+                if(--remaining_dependencies[dependent] == 0)
+                    ready.push(dependent);
+        }
+
+        while(next_log < graph.order.size() && results[graph.order[next_log]].done)
+            write_log(results[graph.order[next_log++]].log);
+    }
+
+    // On error, some files were never processed: Output the remaining logs, still in order.
+    for(; next_log < graph.order.size(); ++next_log)
+        if(results[graph.order[next_log]].done)
+            write_log(results[graph.order[next_log]].log);
+
+    return success;
+}
+
+// Source and AST of a file parsed outside of handle_file (unity builds, standard library precompilation). The AST refers to the source.
+struct ParsedFile {
+    std::shared_ptr<const SourceFile> source;
+    Parser                            parser;
+    std::optional<AST>                ast;
+};
+
+// Parses path and writes its interface to interface_folder, where its dependents import it from. Throws on error.
+std::unique_ptr<ParsedFile> parse_file(DependencyTree& tree, const std::filesystem::path& path, const std::filesystem::path& interface_folder) {
+    auto file = std::make_unique<ParsedFile>();
+    if(auto scan = tree.take_scan(path)) {
+        file->source = std::move(scan->source);
+    } else {
+        file->source = SourceManager::instance().load(path);
+        if(!file->source)
+            throw Exception(fmt::format("[compiler::parse_file] Couldn't open file '{}'.\n", path.string()));
+    }
+    print("Processing {}... \n", path.string());
+    file->parser.get_module_interface().working_directory = path.parent_path();
+    file->parser.set_cache_folder(interface_folder);
+    {
+        TimeTraceScope trace_scope("Parse", path.string());
+        TokenStream    tokens(*file->source);
+        file->ast = file->parser.parse(tokens);
+    }
+    if(!file->ast)
+        throw Exception(fmt::format("[compiler::parse_file] Couldn't parse '{}'.\n", path.string()));
+    file->parser.write_export_interface(ModuleInterface::get_cache_filename(path).replace_extension(".int"));
+    return file;
+}
+
+// Returns true on success
+bool link_bitcode_file(llvm::Linker& linker, llvm::LLVMContext& context, const std::filesystem::path& path) {
+    llvm::SMDiagnostic diagnostic;
+    auto               module = llvm::parseIRFile(path.string(), diagnostic, context);
+    if(!module) {
+        error("[compiler] Could not read {}: {}\n", path.string(), diagnostic.getMessage().str());
+        return false;
+    }
+    if(linker.linkInModule(std::move(module))) {
+        error("[compiler] Could not link {} into the unity module.\n", path.string());
+        return false;
+    }
+    return true;
+}
+
+// Unity build: Every file of the graph is generated into a single LLVM module and optimized as a whole program.
+// Files are still parsed in order, each writing its interface for its dependents, and generated in their own module,
+// which is then linked into the program while sharing its LLVMContext. Only the entry point stays visible: Functions of
+// all modules can be inlined, specialized or discarded by a single pipeline, without an LTO link step.
+// Nothing is cached, the result depends on the whole program.
+// Returns true on success
+bool unity_build(DependencyTree& tree, const DependencyTree::ProcessingGraph& graph, const std::string& final_outputfile) {
+    const auto        codegen_start = std::chrono::high_resolution_clock::now();
+    llvm::LLVMContext llvm_context;
+    auto              program = std::make_unique<llvm::Module>(std::filesystem::path(final_outputfile).stem().string(), llvm_context);
+    llvm::Linker      linker(*program);
+    const auto        target_triple = llvm::sys::getDefaultTargetTriple();
+    const auto        target_machine = get_target_machine();
+    program->setDataLayout(target_machine->createDataLayout());
+    program->setTargetTriple(target_triple);
     try {
-        std::string cmd_input_files;
-        for(const auto& file : object_files) {
-            cmd_input_files += " \"" + file.string() + "\"";
+        for(const auto node : graph.order) {
+            const auto& path = graph.files[node];
+            if(const auto precompiled = find_precompiled_object(path, ".bc")) {
+                if(!import_precompiled_interface(path, *precompiled) || !link_bitcode_file(linker, llvm_context, *precompiled))
+                    return false;
+                continue;
+            }
+            const auto     file = parse_file(tree, path, cache_folder);
+            TimeTraceScope trace_scope("Codegen", path.string());
+            Module         new_module{path.string(), &llvm_context};
+            new_module.codegen_imports(file->parser.get_module_interface().type_imports);
+            new_module.codegen_imports(file->parser.get_module_interface().imports);
+            if(!new_module.codegen(*file->ast)) {
+                warn("LLVM Codegen returned nullptr. Nothing generated for '{}'.\n", path);
+                continue;
+            }
+            if(llvm::verifyModule(new_module.get_llvm_module(), &llvm::errs()))
+                throw Exception("\nErrors in LLVM Module.\n");
+            new_module.get_llvm_module().setDataLayout(program->getDataLayout());
+            new_module.get_llvm_module().setTargetTriple(target_triple);
+            // Declarations of the imported functions are resolved to their definitions, generated by a previous module.
+            if(linker.linkInModule(std::move(new_module.get_llvm_module_ptr()))) {
+                error("[compiler] Could not link {} into the unity module.\n", path.string());
+                return false;
+            }
         }
-        const auto command = fmt::format("clang {} -flto \"{}\" -o \"{}\"", cmd_input_files, LANG_STDLIB_PATH, final_outputfile);
-        print("Running '{}'\n", command);
-        if(auto retval = std::system(command.c_str()); retval != 0) {
-            error("Error running clang: {}.\n", retval);
+    } catch(const Exception& e) {
+        e.display();
+        return false;
+    } catch(const std::exception& e) {
+        error("Exception: {}", e.what());
+        return false;
+    }
+    // The runtime too, when available as bitcode: Its helpers can then be inlined. The archive is still linked, but only resolves what's left.
+    if(std::filesystem::exists(LANG_STDLIB_BITCODE_PATH) && !link_bitcode_file(linker, llvm_context, LANG_STDLIB_BITCODE_PATH))
+        return false;
+
+    llvm::internalizeModule(*program, [](const llvm::GlobalValue& value) { return value.getName() == "main"; });
+
+    apply_target_attributes(*program);
+    if(llvm::verifyModule(*program, &llvm::errs())) {
+        error("[compiler] Errors in the unity module.\n");
+        return false;
+    }
+    const auto codegen_end = std::chrono::high_resolution_clock::now();
+
+    const auto  optimization_start = std::chrono::high_resolution_clock::now();
+    std::string pass_timings;
+    optimize_module(*program, target_machine, LTOMode::None, args["time-passes"].set ? &pass_timings : nullptr);
+    print("{}", pass_timings);
+    const auto optimization_end = std::chrono::high_resolution_clock::now();
+
+    if(args['i'].set) {
+        const auto ir_filepath = args['o'].set ? args['o'].value() : std::filesystem::path(final_outputfile).replace_extension(".ll").string();
+        std::error_code err;
+        auto            file = llvm::raw_fd_ostream(ir_filepath, err);
+        if(err) {
+            error("Error opening '{}': {}\n", ir_filepath, err.message());
             return false;
         }
+        program->print(file, nullptr);
+        success("LLVM IR written to {}.\n", ir_filepath);
+        return true;
+    }
+
+    const auto object_gen_start = std::chrono::high_resolution_clock::now();
+    auto       o_filepath = cache_folder / std::filesystem::path(final_outputfile).filename().replace_extension(".unity.o");
+    if(args['b'].set && args['o'].set)
+        o_filepath = args['o'].value();
+    std::error_code      error_code;
+    llvm::raw_fd_ostream dest(o_filepath.string(), error_code, llvm::sys::fs::OF_None);
+    if(error_code) {
+        error("Could not open file '{}': {}.\n", o_filepath.string(), error_code.message());
+        return false;
+    }
+    llvm::legacy::PassManager passManager;
+    if(target_machine->addPassesToEmitFile(passManager, dest, nullptr, llvm::CGFT_ObjectFile)) {
+        error("Target Machine (Target Triple: {}) can't emit a file of this type.\n", target_triple);
+        return false;
+    }
+    {
+        TimeTraceScope trace_scope("Object generation", o_filepath.string());
+        passManager.run(*program);
+    }
+    dest.close();
+    add_object_file(o_filepath);
+    const auto object_gen_end = std::chrono::high_resolution_clock::now();
+    success("Wrote unity object file '{}' ({} modules, Target Triple: {}).\n", o_filepath.string(), graph.size(), target_triple);
+
+    print(" {:<12} | {:<12} | {:<12} \n", fmt::styled("Frontend", fmt::fg(fmt::color::aquamarine)), fmt::styled("Optimization", fmt::fg(fmt::color::aquamarine)),
+          fmt::styled("ObjectGen", fmt::fg(fmt::color::aquamarine)));
+    print(" {:^12.2} | {:^12.2} | {:^12.2} \n", std::chrono::duration<double, std::milli>(codegen_end - codegen_start),
+          std::chrono::duration<double, std::milli>(optimization_end - optimization_start), std::chrono::duration<double, std::milli>(object_gen_end - object_gen_start));
+    return true;
+}
+
+// Builds the standard library modules (stdlib/exports) as part of the compiler build. Each module gets its interface, an optimized object file
+// (used without LTO) and ThinLTO bitcode (used with LTO and by unity builds) in output_folder, named as in the cache folder.
+// Modules exporting templates only get their interface: Their implementation is needed to generate specializations, they are compiled with the user code.
+// Returns true on success
+bool precompile_stdlib(const std::filesystem::path& output_folder) {
+    std::error_code ec;
+    std::filesystem::create_directories(output_folder, ec);
+    std::vector<std::filesystem::path> sources;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(stdlib_folder, ec))
+        if(entry.path().extension() == ".lang")
+            sources.push_back(entry.path().lexically_normal());
+    if(ec) {
+        error("[compiler] Could not list the standard library modules in {}: {}.\n", stdlib_folder.string(), ec.message());
+        return false;
+    }
+
+    DependencyTree tree;
+    if(!tree.construct(sources))
+        return false;
+    auto graph_or_error = tree.generate_processing_graph();
+    if(graph_or_error.is_error()) {
+        error(graph_or_error.get_error().string());
+        return false;
+    }
+    const auto& graph = graph_or_error.get();
+
+    const auto target_machine = get_target_machine();
+    const auto write_file = [](const std::filesystem::path& path, const std::function<void(llvm::raw_fd_ostream&)>& write) {
+        std::error_code      error_code;
+        llvm::raw_fd_ostream dest(path.string(), error_code, llvm::sys::fs::OF_None);
+        if(error_code)
+            throw Exception(fmt::format("Could not open file '{}': {}.\n", path.string(), error_code.message()));
+        write(dest);
+    };
+    try {
+        for(const auto node : graph.order) {
+            const auto& path = graph.files[node];
+            const auto  file = parse_file(tree, path, output_folder);
+            const auto& module_interface = file->parser.get_module_interface();
+            if(std::any_of(module_interface.exports.begin(), module_interface.exports.end(), [](const auto& f) { return f->is_templated(); }))
+                continue;
 
+            llvm::LLVMContext llvm_context;
+            Module            new_module{path.string(), &llvm_context};
+            new_module.codegen_imports(module_interface.type_imports);
+            new_module.codegen_imports(module_interface.imports);
+            if(!new_module.codegen(*file->ast))
+                continue;
+            auto& module = new_module.get_llvm_module();
+            if(llvm::verifyModule(module, &llvm::errs()))
+                throw Exception("\nErrors in LLVM Module.\n");
+            module.setDataLayout(target_machine->createDataLayout());
+            module.setTargetTriple(llvm::sys::getDefaultTargetTriple());
+
+            auto output_path = output_folder;
+            output_path += ModuleInterface::get_cache_filename(path);
+            // Both pipelines expect an unoptimized module.
+            auto bitcode_module = llvm::CloneModule(module);
+            optimize_module(*bitcode_module, target_machine, LTOMode::Thin, nullptr);
+            write_file(std::filesystem::path(output_path).replace_extension(".bc"), [&](llvm::raw_fd_ostream& dest) {
+                llvm::legacy::PassManager pass_manager;
+                pass_manager.add(llvm::createWriteThinLTOBitcodePass(dest));
+                pass_manager.run(*bitcode_module);
+            });
+
+            optimize_module(module, target_machine, LTOMode::None, nullptr);
+            write_file(std::filesystem::path(output_path).replace_extension(".o"), [&](llvm::raw_fd_ostream& dest) {
+                llvm::legacy::PassManager pass_manager;
+                if(target_machine->addPassesToEmitFile(pass_manager, dest, nullptr, llvm::CGFT_ObjectFile))
+                    throw Exception("Target Machine can't emit an object file.\n");
+                pass_manager.run(module);
+            });
+            success("Precompiled {}.\n", path.string());
+        }
+        std::ofstream(output_folder / precompiled_flags_path.filename()) << get_target_flags() << "\n";
+    } catch(const Exception& e) {
+        e.display();
+        return false;
     } catch(const std::exception& e) {
         error("Exception: {}", e.what());
         return false;
     }
     return true;
-};
+}
+
+// Returns true on success
+bool link(const std::string& final_outputfile) {
+    TimeTraceScope                     trace_scope("Link", final_outputfile);
+    std::vector<std::filesystem::path> inputs{object_files.begin(), object_files.end()};
+    // With LTO, the runtime is optimized along with the program when available as bitcode.
+    if(link_options.lto != LTOMode::None && std::filesystem::exists(LANG_STDLIB_BITCODE_PATH))
+        inputs.push_back(LANG_STDLIB_BITCODE_PATH);
+    else
+        inputs.push_back(LANG_STDLIB_PATH);
+    try {
+        return link_executable(inputs, final_outputfile, link_options);
+    } catch(const std::exception& e) {
+        error("Exception: {}", e.what());
+        return false;
+    }
+}
+
+std::optional<size_t> parse_count(std::string_view str) {
+    size_t r = 0;
+    if(auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), r); ec != std::errc{} || ptr != str.data() + str.size())
+        return std::nullopt;
+    return r;
+}
 
 // Returns true on success
 bool handle_all() {
+    TimeTrace::instance().clear();
+    TemplateStats::instance().clear();
+    ast_memory.clear();
     const auto dependency_start = std::chrono::high_resolution_clock::now();
 
     DependencyTree dependency_tree;
-    for(const auto& path : input_files)
-        if(!dependency_tree.construct(path))
+    build_manifest.new_run();
+    if(!args["bypass-cache"].set)
+        dependency_tree.set_manifest(&build_manifest);
+    const auto                  jobs = get_jobs_count();
+    std::unique_ptr<ThreadPool> pool = jobs > 1 ? std::make_unique<ThreadPool>(jobs) : nullptr;
+    {
+        TimeTraceScope trace_scope("Dependency discovery");
+        if(!dependency_tree.construct({input_files.begin(), input_files.end()}, pool.get()))
             return false;
+    }
 
-    auto processing_stages_or_error = dependency_tree.generate_processing_stages();
-    if(processing_stages_or_error.is_error()) {
-        error(processing_stages_or_error.get_error().string());
+    auto processing_graph_or_error = dependency_tree.generate_processing_graph(estimate_processing_cost);
+    if(processing_graph_or_error.is_error()) {
+        error(processing_graph_or_error.get_error().string());
         return false;
     }
-    auto processing_stages = processing_stages_or_error.get();
+    const auto& processing_graph = processing_graph_or_error.get();
+    watched_files = {processing_graph.files.begin(), processing_graph.files.end()};
+    // A module created where an import looks first (e.g. shadowing a standard library module) must trigger a rebuild, and a new resolution of the import.
+    // Only the existing directories can be watched.
+    for(const auto& probed : dependency_tree.probed_files()) {
+        std::error_code ec;
+        if(std::filesystem::is_directory(probed.parent_path(), ec))
+            watched_files.insert(probed);
+    }
 
     const auto dependency_end = std::chrono::high_resolution_clock::now();
     success("Generated dependency tree in {:.2}.\n", std::chrono::duration<double, std::milli>(dependency_end - dependency_start));
 
     processed_files = {};
+    object_files = {};
     const auto start = std::chrono::high_resolution_clock::now();
+    auto       final_outputfile = args['o'].set ? args['o'].value() : input_files.size() == 1 ? (*input_files.begin()).filename().replace_extension(".exe").string() : "a.out";
 
-    // TODO: We could parallelize here. (GlobalTypeRegister will be a problem.)
-    for(const auto& stage : processing_stages)
-        for(const auto& file : stage)
-            if(!handle_file(file))
-                return false;
+    if(args["unity"].set) {
+        if(!unity_build(dependency_tree, processing_graph, final_outputfile))
+            return false;
+        // The output is the whole program IR or object file.
+        if(args['i'].set || args['b'].set)
+            return true;
+    } else if(!process_graph(dependency_tree, processing_graph, pool.get()))
+        return false;
 
-    const auto clang_start = std::chrono::high_resolution_clock::now();
-    auto       final_outputfile = args['o'].set ? args['o'].value() : input_files.size() == 1 ? (*input_files.begin()).filename().replace_extension(".exe").string() : "a.out";
+    const auto link_start = std::chrono::high_resolution_clock::now();
 
     if(!link(final_outputfile))
         return false;
-    const auto clang_end = std::chrono::high_resolution_clock::now();
+    const auto link_end = std::chrono::high_resolution_clock::now();
     const auto end = std::chrono::high_resolution_clock::now();
-    success("Compiled successfully to {} in {:.2} (clang: {:.2}).\n", final_outputfile, std::chrono::duration<double, std::milli>(end - start),
-            std::chrono::duration<double, std::milli>(clang_end - clang_start));
+    success("Compiled successfully to {} in {:.2} (link: {:.2}).\n", final_outputfile, std::chrono::duration<double, std::milli>(end - start),
+            std::chrono::duration<double, std::milli>(link_end - link_start));
 
     // Run the generated program. FIXME: Handy, but dangerous.
     if(args['r'].set) {
@@ -326,26 +1174,214 @@ bool handle_all() {
         print("\n > {} returned {} after {}.\n", final_outputfile, retval, std::chrono::duration<double, std::milli>(execution_end - execution_start));
     }
 
+    if(args["bench"].set) {
+        ExecutableBenchmark benchmark;
+        benchmark.executable = std::filesystem::absolute(final_outputfile);
+        benchmark.arguments = args['r'].values;
+        benchmark.warmup_runs = args["bench-warmup"].set ? *parse_count(args["bench-warmup"].value()) : 1;
+        print("Benchmarking {}...\n", final_outputfile);
+        if(!benchmark.run(*parse_count(args["bench"].value())))
+            return false;
+        if(args["bench-report"].set && args["bench-report"].value() == "json")
+            fmt::print("{}", benchmark.json_report());
+        else
+            print("{}", benchmark.text_report());
+    }
+
     return true;
 }
 
-int main(int argc, char* argv[]) {
-    info("  █░░  <insert language name> compiler\n");
-    info("  █▄▄  v0.0.1\n");
+// Watch mode
+// Each watcher monitors a directory, but only triggers for the files of the dependency graph it contains.
+std::map<std::filesystem::path, std::set<std::string>>                                watched_directories;
+std::map<std::filesystem::path, std::unique_ptr<filewatch::FileWatch<std::string>>> watchers;
+std::mutex                                                                            changes_mutex;
+std::condition_variable                                                               changes_condition;
+std::set<std::filesystem::path>                                                       changed_files;
+std::chrono::steady_clock::time_point                                                 last_change;
+
+std::string escape_regex(const std::string& str) {
+    static const std::string_view special_chars = R"(\^$.|?*+()[]{}-)";
+    std::string                   r;
+    for(const auto c : str) {
+        if(special_chars.find(c) != special_chars.npos)
+            r += '\\';
+        r += c;
+    }
+    return r;
+}
+
+// Called from the watchers' threads.
+void on_file_changed(const std::filesystem::path& path) {
+    {
+        std::lock_guard lock(changes_mutex);
+        changed_files.insert(path);
+        last_change = std::chrono::steady_clock::now();
+    }
+    changes_condition.notify_one();
+}
+
+void update_watchers(const std::set<std::filesystem::path>& files) {
+    std::map<std::filesystem::path, std::set<std::string>> directories;
+    for(const auto& file : files)
+        directories[file.parent_path()].insert(file.filename().string());
+
+    std::erase_if(watchers, [&](const auto& watcher) { return !directories.contains(watcher.first); });
+    for(const auto& [directory, filenames] : directories) {
+        if(watchers.contains(directory) && watched_directories[directory] == filenames)
+            continue;
+        std::string pattern;
+        for(const auto& filename : filenames)
+            pattern += (pattern.empty() ? "" : "|") + escape_regex(filename);
+        watchers[directory] = std::make_unique<filewatch::FileWatch<std::string>>(
+            directory.string(), std::regex(pattern), [directory](const std::string& file, const filewatch::Event) { on_file_changed(directory / file); });
+    }
+    watched_directories = std::move(directories);
+}
+
+// Blocks until some watched files are modified, and returns them.
+std::set<std::filesystem::path> wait_for_changes() {
+    // Saving a file may trigger several events: Wait for them to settle, this also makes sure the file is readable again.
+    constexpr auto   settle_time = std::chrono::milliseconds(30);
+    std::unique_lock lock(changes_mutex);
+    changes_condition.wait(lock, [] { return !changed_files.empty(); });
+    while(std::chrono::steady_clock::now() - last_change < settle_time)
+        changes_condition.wait_until(lock, last_change + settle_time);
+    std::set<std::filesystem::path> r;
+    std::swap(r, changed_files);
+    return r;
+}
+
+// Settings of the cache store: Command line options take precedence over the environment.
+std::filesystem::path get_cache_directory() {
+    if(args["cache-dir"].set)
+        return args["cache-dir"].value();
+    if(const auto env = std::getenv("LANG_CACHE_DIR"); env && *env)
+        return env;
+    return cache_folder / "store";
+}
 
+uintmax_t get_cache_max_size() {
+    constexpr uintmax_t default_size_mib = 1024;
+    std::string         value;
+    if(args["cache-size"].set)
+        value = args["cache-size"].value();
+    else if(const auto env = std::getenv("LANG_CACHE_SIZE"); env && *env)
+        value = env;
+    else
+        return default_size_mib * 1024 * 1024;
+    uintmax_t size_mib = 0;
+    if(auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), size_mib); ec != std::errc{} || ptr != value.data() + value.size()) {
+        warn("[compiler] Invalid cache size '{}', using the default of {}MiB.\n", value, default_size_mib);
+        size_mib = default_size_mib;
+    }
+    return size_mib * 1024 * 1024;
+}
+
+// Keeps the cache store within its size limit, should be called after each run.
+void maintain_cache() {
+    build_manifest.save(cache_folder / "manifest.bin");
+    build_cache->evict();
+    if(args["cache-stats"].set) {
+        build_cache->print_stats();
+        print("  {} modules up to date according to the build manifest\n", build_manifest.up_to_date_count());
+    }
+}
+
+// Outputs the time trace of the last run, as requested by --time-trace and --time-report.
+void report_time_trace() {
+    auto& time_trace = TimeTrace::instance();
+    if(!time_trace.is_enabled())
+        return;
+    const auto wall_time = time_trace.now();
+    if(args["time-trace"].set) {
+        if(time_trace.write_chrome_trace(args["time-trace"].value()))
+            success("Time trace written to {}.\n", args["time-trace"].value());
+        else
+            error("[compiler] Could not write time trace to {}.\n", args["time-trace"].value());
+    }
+    if(args["time-report"].set) {
+        if(args["time-report"].value() == "json")
+            fmt::print("{}", time_trace.json_report(wall_time));
+        else
+            print("{}", time_trace.text_report(wall_time));
+    }
+}
+
+// Prints the resident set size of each phase, and the memory held by the main data structures.
+// The peak is process wide: When phases overlap (-j), its growth is attributed to each of them.
+void report_memory_stats() {
+    if(!args["mem-stats"].set)
+        return;
+    constexpr auto mib = 1024.0 * 1024.0;
+    print("Memory (peak resident set size: {:.1f}MiB):\n", get_peak_rss() / mib);
+    print(" {:<24} | {:>14} | {:>14}\n", "Phase", "Max RSS at end", "Peak growth");
+    for(const auto& summary : TimeTrace::instance().summarize())
+        if(summary.max_rss > 0 && summary.name[0] >= 'A' && summary.name[0] <= 'Z') // Skip the LLVM passes, named after their classes.
+            print(" {:<24} | {:>11.1f}MiB | {:>11.1f}MiB\n", summary.name, summary.max_rss / mib, summary.max_peak_rss_growth / mib);
+    print(" {:<24} | {:>14} | {:>14} | {:>10}\n", "Data structure", "Current", "Peak", "Count");
+    const auto print_counter = [&](std::string_view name, const memory_stats::Counter& counter) {
+        print(" {:<24} | {:>11.2f}MiB | {:>11.2f}MiB | {:>10}\n", name, counter.bytes / mib, counter.peak / mib, counter.count.load());
+    };
+    print_counter("Tokens", memory_stats::tokens);
+    print_counter("AST nodes", memory_stats::ast_nodes);
+    print_counter("Interned strings", memory_stats::fly_strings);
+    print_counter("Type registry", memory_stats::type_registry);
+    // Not in bytes: LLVM doesn't report the memory used by a module.
+    print(" {:<24} | {:>7} instr. | {:>7} instr. | {:>10}\n", "LLVM modules", memory_stats::llvm_modules.bytes.load(), memory_stats::llvm_modules.peak.load(),
+          memory_stats::llvm_modules.count.load());
+    print(" {:>17} | {:>10} | {}\n", "Bytes (all files)", "Count", "AST node type");
+    for(const auto& [type, memory] : ast_memory)
+        print(" {:>17} | {:>10} | {}\n", memory.bytes, memory.count, type);
+}
+
+// Prints the cost of the template instantiations of the last run, most expensive first.
+void report_template_stats() {
+    if(!TemplateStats::instance().is_enabled())
+        return;
+    const auto templates = TemplateStats::instance().get_sorted();
+    print("Template instantiations:\n");
+    print(" {:<48} | {:>6} | {:>8} | {:>9} | {:>10} | {:>8}\n", "Template", "Count", "Distinct", "AST nodes", "Time", "IR instr.");
+    for(const auto& t : templates)
+        print(" {:<48} | {:>6} | {:>8} | {:>9} | {:>8.2f}ms | {:>8}\n", t.name, t.instantiations, t.type_arguments.size(), t.cloned_nodes, t.duration, t.ir_instructions);
+}
+
+void add_options() {
     args.add('o', "out", 1, 1, "Specify the output file.");
     args.add('t', "tokens", 0, 0, "Dump the state after the tokenizing stage.");
     args.add('a', "ast", 0, 0, "Dump the parsed AST to the command line.");
     args.add('l', "llvm-ir", 0, 0, "Dump the LLVM IR to the command line.");
     args.add('i', "ir", 0, 0, "Output LLVM Intermediate Representation.");
     args.add('r', "run", 0, 256, "Run the resulting executable.");
+    args.add('\0', "bench", 1, 1, "Run the resulting executable N times, with the arguments of --run, and print statistics on its time and memory usage.");
+    args.add('\0', "bench-warmup", 1, 1, "Number of unmeasured runs before the benchmark (Default: 1).");
+    args.add('\0', "bench-report", 1, 1, "Format of the benchmark statistics: text (Default) or json.");
     args.add('b', "object", 0, 0, "Output an object file.");
-    args.add('j', "jit", 0, 0, "Run the module using JIT.");
+    args.add('j', "jobs", 1, 1, "Process independent files in parallel using N threads (0: number of hardware threads).");
+    args.add('\0', "jit", 0, 0, "Run the module using JIT.");
     args.add('w', "watch", 0, 0, "Watch the supplied file and re-run on changes.");
     args.add('n', "bypass-cache", 0, 0, "Ignore the cache generated by previous invocations.");
-    args.parse(argc, argv);
+    args.add('\0', "cache-dir", 1, 1, "Compilation cache directory, can be shared (Default: $LANG_CACHE_DIR, or ./lang_cache/store).");
+    args.add('\0', "cache-size", 1, 1, "Maximum size of the compilation cache in MiB (Default: $LANG_CACHE_SIZE, or 1024).");
+    args.add('\0', "cache-stats", 0, 0, "Print compilation cache statistics.");
+    args.add('O', "optimize", 1, 1, "Optimization level: 0 (skips the optimization pipeline, fastest builds), 1, 2, 3 (Default) or s (size).");
+    args.add('\0', "time-passes", 0, 0, "Print the time spent in each optimization pass.");
+    args.add('\0', "time-trace", 1, 1, "Write the time spent in each compilation phase to the specified file, as Chrome trace events (chrome://tracing).");
+    args.add('\0', "mem-stats", 0, 0, "Print the peak memory usage of each compilation phase and the memory held by the main data structures.");
+    args.add('\0', "template-stats", 0, 0, "Print the number and cost of the instantiations of each template.");
+    args.add('\0', "time-report", 1, 1, "Print the time spent in each compilation phase, aggregated across files: text or json.");
+    args.add('\0', "target-cpu", 1, 1, "CPU to generate code for: native (the host CPU), or a name such as x86-64-v3 or skylake (Default: generic).");
+    args.add('\0', "target-features", 1, 1, "Comma separated list of CPU features to enable (+) or disable (-), e.g. +avx2,+bmi2.");
+    args.add('\0', "lto", 1, 1, "Link Time Optimization: none (Default, fastest builds), thin (parallel, cached in ./lang_cache/lto) or full.");
+    args.add('\0', "precompile-stdlib", 1, 1, "Precompile the standard library modules to the specified folder (Part of the compiler build).");
+    args.add('\0', "unity", 0, 0, "Generate all files into a single module, optimized as a whole program (Default optimization level: 3).");
+    args.add('\0', "server", 0, 0, "Stay resident and serve the requests of compiler-client over a local socket.");
+    args.add('\0', "socket", 1, 1, "Socket of the compile server (Default: $LANG_SERVER_SOCKET, or a per-user socket in the temporary directory).");
+}
 
-    if(!args.has_default_args()) {
+// Compiles the input files according to the parsed arguments, returns the exit code of the process.
+int compile() {
+    if(!args.has_default_args() && !args["precompile-stdlib"].set) {
         error("No source file provided.\n");
         print("Usage: 'compiler path/to/source.lang'.\n");
         args.print_help();
@@ -354,6 +1390,62 @@ int main(int argc, char* argv[]) {
 
     if(!std::filesystem::exists(cache_folder))
         std::filesystem::create_directory(cache_folder);
+    build_cache = std::make_unique<BuildCache>(get_cache_directory(), get_cache_max_size());
+    build_manifest.load(cache_folder / "manifest.bin");
+
+    if(args["lto"].set) {
+        const auto lto = parse_lto_mode(args["lto"].value());
+        if(!lto) {
+            error("Invalid LTO mode '{}', expected none, thin or full.\n", args["lto"].value());
+            return -1;
+        }
+        link_options.lto = *lto;
+    }
+    if(args["unity"].set) {
+        // The whole program is already visible to the optimizer.
+        if(link_options.lto != LTOMode::None)
+            warn("[compiler] --lto is ignored in unity builds.\n");
+        link_options.lto = LTOMode::None;
+    }
+    if(args["time-report"].set && args["time-report"].value() != "text" && args["time-report"].value() != "json") {
+        error("Invalid time report format '{}', expected text or json.\n", args["time-report"].value());
+        return -1;
+    }
+    if(args["bench"].set && (!parse_count(args["bench"].value()) || *parse_count(args["bench"].value()) == 0)) {
+        error("Invalid number of benchmark runs '{}'.\n", args["bench"].value());
+        return -1;
+    }
+    if(args["bench-warmup"].set && !parse_count(args["bench-warmup"].value())) {
+        error("Invalid number of warmup runs '{}'.\n", args["bench-warmup"].value());
+        return -1;
+    }
+    if(args["bench-report"].set && args["bench-report"].value() != "text" && args["bench-report"].value() != "json") {
+        error("Invalid benchmark report format '{}', expected text or json.\n", args["bench-report"].value());
+        return -1;
+    }
+    if(args["time-trace"].set || args["time-report"].set || args["mem-stats"].set)
+        TimeTrace::instance().enable(args["mem-stats"].set);
+    if(args["template-stats"].set)
+        TemplateStats::instance().enable();
+    if(args['O'].set) {
+        const auto level = parse_optimization_level(args['O'].value());
+        if(!level) {
+            error("Invalid optimization level '{}', expected 0, 1, 2, 3 or s.\n", args['O'].value());
+            return -1;
+        }
+        optimization_level = *level;
+    }
+    if(!resolve_target_options())
+        return -1;
+    link_options.optimization_level = optimization_level.getSpeedupLevel();
+    link_options.cpu = target_cpu;
+    link_options.features = target_features;
+    link_options.lto_cache_directory = cache_folder / "lto";
+    link_options.lto_cache_size = build_cache->max_size();
+    if(args['j'].set)
+        link_options.jobs = get_jobs_count();
+    if(args["precompile-stdlib"].set)
+        return precompile_stdlib(args["precompile-stdlib"].value()) ? 0 : 1;
 
     for(const auto& arg : args.get_default_args()) {
         const auto abs_path = std::filesystem::absolute(std::filesystem::path(arg));
@@ -361,36 +1453,188 @@ int main(int argc, char* argv[]) {
     }
 
     auto r = handle_all();
+    maintain_cache();
+    report_time_trace();
+    report_template_stats();
+    report_memory_stats();
     if(args['w'].set) {
-        auto last_run = std::chrono::system_clock::now();
-
-        auto rerun = [&](const std::string& path, const filewatch::Event) {
-            if(std::chrono::system_clock::now() - last_run < std::chrono::seconds(1)) // Ignore double events
-                return;
-            fmt::print("[{:%T}] <insert lang name> compiler: {} changed, reprocessing...\n", std::chrono::system_clock::now(), path);
-            // Wait a bit, at least on Windows it looks like the file read will fail if attempted right after the modification event.
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            r = handle_all(); // TODO: Recompile only modified files.
-            last_run = std::chrono::system_clock::now();
+        success("\n[{:%T}] Watching for changes... ", std::chrono::system_clock::now());
+        fmt::print("(CTRL+C to exit)\n\n");
+        while(true) {
+            // Keep watching the inputs even if the dependency graph couldn't be constructed.
+            watched_files.insert(input_files.begin(), input_files.end());
+            update_watchers(watched_files);
+            const auto               changes = wait_for_changes();
+            std::vector<std::string> changed;
+            for(const auto& path : changes)
+                changed.push_back(path.string());
+            invalidate_resolved_dependencies(changes);
+            fmt::print("[{:%T}] <insert lang name> compiler: {} changed, reprocessing...\n", std::chrono::system_clock::now(), fmt::join(changed, ", "));
+            // Only the modified files and the dependents of modified interfaces are processed again, everything else is known up to date from the manifest.
+            r = handle_all();
+            maintain_cache();
+            report_time_trace();
+            report_template_stats();
+            report_memory_stats();
             success("\n[{:%T}] Watching for changes... ", std::chrono::system_clock::now());
             fmt::print("(CTRL+C to exit)\n\n");
-        };
+        }
+    }
+    return r ? 0 : 1;
+}
+
+#ifndef WIN32
+// Compile server
+// The server pays the fixed costs of an invocation once (process startup, LLVM target initialization and target machine creation, reading
+// the standard library interfaces), then serves each request in a forked copy of itself: Requests start from this warm state, but don't leak into each
+// other (the type registry and template cache are global), and a crash only affects the faulty request.
+
+// Reads the precompiled interfaces of the standard library: Requests import them from memory.
+// Their types are not registered ahead of time: The registry merges types by name, a request declaring its own type named like a
+// standard library one (without importing it) would get the layout of the standard library type.
+void preload_stdlib_interfaces() {
+    std::error_code ec;
+    size_t          count = 0;
+    for(const auto& entry : std::filesystem::recursive_directory_iterator(stdlib_folder, ec)) {
+        if(entry.path().extension() != ".lang")
+            continue;
+        auto interface_path = std::filesystem::path(LANG_STDLIB_PRECOMPILED_FOLDER);
+        interface_path += ModuleInterface::get_cache_filename(entry.path().lexically_normal()).replace_extension(".int");
+        if(read_interface_file(interface_path))
+            ++count;
+    }
+    print_subtle("[server] Preloaded {} standard library interfaces.\n", count);
+}
+
+// Runs in the process forked for a request, returns its exit code.
+int serve_request(const server_protocol::Request& request) {
+    if(chdir(request.working_directory.c_str()) != 0) {
+        error("[server] Could not change the working directory to {}: {}.\n", request.working_directory, std::strerror(errno));
+        return -1;
+    }
+    std::vector<char*> argv;
+    for(const auto& argument : request.arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(nullptr);
+    args.reset();
+    args.parse(static_cast<int>(argv.size() - 1), argv.data());
+    if(args['w'].set || args["server"].set) {
+        error("[server] --watch and --server are not supported through the compile server.\n");
+        return -1;
+    }
+    return compile();
+}
+
+// Handles a connection, in its own process: The compilation runs in a child process so its exit code is reported even if it crashes.
+void handle_connection(int connection) {
+    signal(SIGCHLD, SIG_DFL); // Child processes of the compilation (linker, executable) are waited for.
+    const auto request = server_protocol::receive_request(connection);
+    if(!request)
+        _exit(1);
+    for(int i = 0; i < 3; ++i)
+        dup2(request->fds[i], i);
+
+    const auto worker = fork();
+    if(worker == 0) {
+        close(connection);
+        const auto exit_code = serve_request(*request);
+        std::fflush(nullptr);
+        _exit(exit_code);
+    }
+    int status = 0;
+    while(worker > 0 && waitpid(worker, &status, 0) < 0 && errno == EINTR)
+        ;
+    int32_t exit_code = -1;
+    if(worker < 0)
+        error("[server] Could not fork: {}.\n", std::strerror(errno));
+    else if(WIFEXITED(status))
+        exit_code = WEXITSTATUS(status);
+    else if(WIFSIGNALED(status)) {
+        error("[server] Compilation terminated by signal {}.\n", WTERMSIG(status));
+        exit_code = 128 + WTERMSIG(status);
+    }
+    std::fflush(nullptr);
+    server_protocol::send_exit_code(connection, exit_code);
+    _exit(0);
+}
+
+int run_server() {
+    const auto socket_path = args["socket"].set ? std::filesystem::path(args["socket"].value()) : server_protocol::get_socket_path();
+    // Requests run with the privileges of the server (-r runs the executable): Only its user may connect.
+    if(socket_path.parent_path() == server_protocol::get_private_socket_directory() && !server_protocol::make_private_directory(socket_path.parent_path())) {
+        error("[server] '{}' must be a directory only accessible to the current user.\n", socket_path.parent_path().string());
+        return -1;
+    }
+    sockaddr_un address;
+    if(!server_protocol::make_address(socket_path, address)) {
+        error("[server] Socket path '{}' is too long.\n", socket_path.string());
+        return -1;
+    }
+    const auto listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0) {
+        error("[server] Could not create socket: {}.\n", std::strerror(errno));
+        return -1;
+    }
+    // Replace the socket of a previous server, unless it is still running.
+    if(connect(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        error("[server] A compile server is already listening on '{}'.\n", socket_path.string());
+        return -1;
+    }
+    unlink(socket_path.c_str());
+    const auto previous_umask = umask(0177); // The socket is created with mode 0600.
+    const auto bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    umask(previous_umask);
+    if(!bound || listen(listener, 64) != 0) {
+        error("[server] Could not listen on '{}': {}.\n", socket_path.string(), std::strerror(errno));
+        return -1;
+    }
+
+    get_target_machine(); // Reused by the requests using the default target options.
+    preload_stdlib_interfaces();
 
-        auto file_to_watch = (*input_files.begin()).string();
-        // Filewatch doesn't have a simple way to watch multiple files, we'll watch the parent directory for now.
-        if(input_files.size() > 1) {
-            std::vector<std::string> paths;
-            std::transform(input_files.begin(), input_files.end(), std::back_inserter(paths), [](const auto& p) { return p.string(); });
-            file_to_watch = longest_common_prefix(paths);
-            file_to_watch = std::filesystem::path(file_to_watch).parent_path().string();
+    signal(SIGCHLD, SIG_IGN); // Connection handlers are reaped automatically.
+    signal(SIGPIPE, SIG_IGN);
+    success("[{:%T}] Compile server listening on '{}'. ", std::chrono::system_clock::now(), socket_path.string());
+    fmt::print("(CTRL+C to exit)\n");
+    while(true) {
+        const auto connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if(connection < 0) {
+            if(errno != EINTR)
+                error("[server] accept failed: {}.\n", std::strerror(errno));
+            continue;
         }
-        filewatch::FileWatch<std::string> watchers(file_to_watch, rerun);
+        if(const auto uid = server_protocol::get_peer_uid(connection); !uid || *uid != getuid()) {
+            warn("[server] Rejected a connection from another user.\n");
+            close(connection);
+            continue;
+        }
+        std::fflush(nullptr); // Don't duplicate buffered output in the child.
+        const auto handler = fork();
+        if(handler == 0) {
+            close(listener);
+            handle_connection(connection);
+        }
+        if(handler < 0)
+            error("[server] Could not fork: {}.\n", std::strerror(errno));
+        close(connection);
+    }
+}
+#endif
 
-        success("\n[{:%T}] Watching for changes... ", std::chrono::system_clock::now());
-        fmt::print("(CTRL+C to exit)\n\n");
-        // TODO: Provide a prompt?
-        while(true)
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+int main(int argc, char* argv[]) {
+    info("  █░░  <insert language name> compiler\n");
+    info("  █▄▄  v{}\n", compiler_version);
+
+    add_options();
+    args.parse(argc, argv);
+
+    if(args["server"].set) {
+#ifndef WIN32
+        return run_server();
+#else
+        error("The compile server is not supported on this platform.\n");
+        return -1;
+#endif
     }
-    return r ? 0 : 1;
+    return compile();
 }
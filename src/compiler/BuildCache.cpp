@@ -0,0 +1,191 @@
+#include <BuildCache.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include <Logger.hpp>
+#include <TemporaryFile.hpp>
+
+// Leftovers of interrupted writes are only removed once we're sure they're not still being written.
+static constexpr auto stale_file_age = std::chrono::hours(1);
+// Other instances sharing the store only protect the entries they are about to link by touching them (see lookup): Recently used
+// entries are kept, even if the store then exceeds its maximum size.
+static constexpr auto in_use_age = std::chrono::minutes(10);
+
+static std::string format_bytes(uintmax_t bytes) {
+    if(bytes < 1024)
+        return fmt::format("{}B", bytes);
+    if(bytes < 1024 * 1024)
+        return fmt::format("{:.1f}KiB", bytes / 1024.0);
+    return fmt::format("{:.1f}MiB", bytes / (1024.0 * 1024.0));
+}
+
+static uintmax_t file_size_or_zero(const std::filesystem::path& path) {
+    std::error_code ec;
+    const auto      size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+BuildCache::BuildCache(const std::filesystem::path& root, uintmax_t max_size) : _root(root), _max_size(max_size) {
+    std::error_code ec;
+    std::filesystem::create_directories(_root, ec);
+    if(ec)
+        error("[BuildCache] Could not create cache directory {}: {}.\n", _root.string(), ec.message());
+}
+
+std::filesystem::path BuildCache::entry_path(uint64_t key, const char* extension) const {
+    return _root / fmt::format("{:016x}{}", key, extension);
+}
+
+void BuildCache::mark_as_used(uint64_t key) {
+    std::lock_guard lock(_used_mutex);
+    _used.insert(key);
+}
+
+std::optional<BuildCache::Entry> BuildCache::lookup(uint64_t key) {
+    const auto    meta_path = entry_path(key, ".meta");
+    std::ifstream meta_file(meta_path);
+    Entry         entry{entry_path(key, ".o"), entry_path(key, ".int")};
+    if(!meta_file || !(meta_file >> std::hex >> entry.interface_hash) || !std::filesystem::exists(entry.object) || !std::filesystem::exists(entry.interface)) {
+        ++_stats.misses;
+        return std::nullopt;
+    }
+    meta_file.close();
+
+    std::error_code ec;
+    std::filesystem::last_write_time(meta_path, std::filesystem::file_time_type::clock::now(), ec); // Recently used, ignore failures.
+    mark_as_used(key);
+    ++_stats.hits;
+    _stats.bytes_read += file_size_or_zero(entry.object) + file_size_or_zero(entry.interface);
+    return entry;
+}
+
+std::optional<std::filesystem::path> BuildCache::touch(uint64_t key) {
+    auto            object = entry_path(key, ".o");
+    std::error_code ec;
+    // Fails if the entry has been evicted.
+    std::filesystem::last_write_time(entry_path(key, ".meta"), std::filesystem::file_time_type::clock::now(), ec);
+    if(ec || !std::filesystem::exists(object)) {
+        ++_stats.misses;
+        return std::nullopt;
+    }
+    mark_as_used(key);
+    ++_stats.hits;
+    return object;
+}
+
+std::filesystem::path BuildCache::temporary_object_path(uint64_t key) const {
+    return make_temporary_path(entry_path(key, ".o"));
+}
+
+std::optional<BuildCache::Entry> BuildCache::insert(uint64_t key, const std::filesystem::path& temporary_object, const std::filesystem::path& interface,
+                                                    uint64_t interface_hash) {
+    Entry entry{entry_path(key, ".o"), entry_path(key, ".int"), interface_hash};
+    mark_as_used(key);
+
+    if(!commit_temporary_file(temporary_object, entry.object)) {
+        error("[BuildCache] Could not move object file to {}.\n", entry.object.string());
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    const auto      temporary_interface = make_temporary_path(entry.interface);
+    std::filesystem::copy_file(interface, temporary_interface, std::filesystem::copy_options::overwrite_existing, ec);
+    if(ec || !commit_temporary_file(temporary_interface, entry.interface)) {
+        error("[BuildCache] Could not copy interface file {} to {}.\n", interface.string(), entry.interface.string());
+        return std::nullopt;
+    }
+
+    // Written last: Marks the entry as complete.
+    const auto meta_path = entry_path(key, ".meta");
+    const auto temporary_meta = make_temporary_path(meta_path);
+    {
+        std::ofstream meta_file(temporary_meta);
+        meta_file << std::hex << interface_hash << "\n";
+        if(!meta_file) {
+            error("[BuildCache] Could not write {}.\n", temporary_meta.string());
+            return std::nullopt;
+        }
+    }
+    if(!commit_temporary_file(temporary_meta, meta_path)) {
+        error("[BuildCache] Could not move metadata file to {}.\n", meta_path.string());
+        return std::nullopt;
+    }
+
+    _stats.bytes_written += file_size_or_zero(entry.object) + file_size_or_zero(entry.interface) + file_size_or_zero(meta_path);
+    return entry;
+}
+
+void BuildCache::evict() {
+    struct EntryInfo {
+        std::vector<std::filesystem::path> files;
+        uintmax_t                          size = 0;
+        bool                               complete = false;
+        std::filesystem::file_time_type    last_use = std::filesystem::file_time_type::min();
+    };
+    std::unordered_map<uint64_t, EntryInfo> entries;
+
+    const auto      now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for(const auto& file : std::filesystem::directory_iterator(_root, ec)) {
+        if(!file.is_regular_file(ec))
+            continue;
+        const auto filename = file.path().filename().string();
+        const auto last_write = file.last_write_time(ec);
+        if(ec)
+            continue;
+        if(filename.find(".tmp") != std::string::npos) {
+            if(now - last_write > stale_file_age)
+                std::filesystem::remove(file.path(), ec);
+            continue;
+        }
+        uint64_t key = 0;
+        if(filename.size() < 16 || std::from_chars(filename.data(), filename.data() + 16, key, 16).ptr != filename.data() + 16)
+            continue; // Not one of ours.
+        auto& info = entries[key];
+        info.files.push_back(file.path());
+        if(const auto size = file.file_size(ec); !ec)
+            info.size += size;
+        if(file.path().extension() == ".meta") {
+            info.complete = true;
+            info.last_use = last_write;
+        } else if(!info.complete)
+            info.last_use = std::max(info.last_use, last_write);
+    }
+
+    std::vector<std::pair<uint64_t, EntryInfo*>> candidates;
+    uintmax_t                                    total_size = 0;
+    std::lock_guard                              lock(_used_mutex);
+    for(auto& [key, info] : entries) {
+        total_size += info.size;
+        // Incomplete entries may still be being written by another instance.
+        if(!_used.contains(key) && (info.complete ? now - info.last_use > in_use_age : now - info.last_use > stale_file_age))
+            candidates.emplace_back(key, &info);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) { return lhs.second->last_use < rhs.second->last_use; });
+
+    for(const auto& [key, info] : candidates) {
+        if(total_size <= _max_size)
+            break;
+        // Remove the metadata first so the entry is never seen as complete while partially deleted.
+        std::partition(info->files.begin(), info->files.end(), [](const auto& file) { return file.extension() == ".meta"; });
+        for(const auto& file : info->files)
+            std::filesystem::remove(file, ec);
+        total_size -= info->size;
+        ++_stats.evicted_entries;
+        _stats.evicted_bytes += info->size;
+    }
+    _stats.size = total_size;
+}
+
+void BuildCache::print_stats() const {
+    const auto lookups = _stats.hits + _stats.misses;
+    print("Cache statistics ({}):\n", _root.string());
+    print("  {} hits, {} misses ({:.1f}% hit rate)\n", _stats.hits.load(), _stats.misses.load(), lookups > 0 ? 100.0 * _stats.hits / lookups : 0.0);
+    print("  {} read, {} written\n", format_bytes(_stats.bytes_read), format_bytes(_stats.bytes_written));
+    print("  {} / {} used, {} entries evicted ({})\n", format_bytes(_stats.size), format_bytes(_max_size), _stats.evicted_entries, format_bytes(_stats.evicted_bytes));
+}
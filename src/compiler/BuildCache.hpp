@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+
+// Content-addressed store of compilation results, shareable between concurrent compiler instances and checkouts.
+// Each entry is keyed by the hash of all the inputs of a module and holds its object file, its interface file and the hash of this interface.
+// Files are written on the side and renamed into place, the .meta file being written last: An entry is visible only once complete.
+// Entries are evicted in least recently used order once the store exceeds its maximum size: Each lookup touches the .meta file.
+class BuildCache {
+  public:
+    struct Entry {
+        std::filesystem::path object;
+        std::filesystem::path interface;
+        uint64_t              interface_hash = 0;
+    };
+
+    struct Stats {
+        std::atomic<size_t>    hits = 0;
+        std::atomic<size_t>    misses = 0;
+        std::atomic<uintmax_t> bytes_read = 0;
+        std::atomic<uintmax_t> bytes_written = 0;
+        size_t                 evicted_entries = 0;
+        uintmax_t              evicted_bytes = 0;
+        uintmax_t              size = 0; // Size of the store after the last eviction pass.
+    };
+
+    BuildCache(const std::filesystem::path& root, uintmax_t max_size);
+
+    const std::filesystem::path& root() const { return _root; }
+    uintmax_t                    max_size() const { return _max_size; }
+    const Stats&                 stats() const { return _stats; }
+
+    // Marks the entry as recently used.
+    std::optional<Entry> lookup(uint64_t key);
+    // Marks the entry as recently used when its content is already known (e.g. from the build manifest), without reading its metadata.
+    // Returns the path to its object file, or nothing if the entry is not (or no longer) in the store.
+    std::optional<std::filesystem::path> touch(uint64_t key);
+    // Temporary location to write the object file of key to, before inserting it.
+    std::filesystem::path temporary_object_path(uint64_t key) const;
+    // Moves temporary_object into the store and copies interface. Returns the stored entry on success.
+    std::optional<Entry> insert(uint64_t key, const std::filesystem::path& temporary_object, const std::filesystem::path& interface, uint64_t interface_hash);
+
+    // Removes the least recently used entries until the store fits in its maximum size. Entries used by this instance, or recently used
+    // by any instance (they may be about to be linked), are kept.
+    void evict();
+    void print_stats() const;
+
+  private:
+    std::filesystem::path _root;
+    uintmax_t             _max_size;
+    Stats                 _stats;
+
+    std::mutex         _used_mutex;
+    std::set<uint64_t> _used; // Entries looked up or inserted by this instance.
+
+    std::filesystem::path entry_path(uint64_t key, const char* extension) const;
+    void                  mark_as_used(uint64_t key);
+};
@@ -0,0 +1,265 @@
+#include <BuildManifest.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include <Logger.hpp>
+#include <MappedFile.hpp>
+#include <TemporaryFile.hpp>
+
+// File format (native endianness):
+//   Magic, u32 format version, u32 record count
+//   Records: Path, u64 source size, i64 source modification time, u64 source hash, u64 inputs hash, u64 interface hash, Path object,
+//            u32 dependency count, Path dependencies..., u32 probe count, (Path probed file, u8 existed)...
+//   Paths are stored as their u32 length followed by their (UTF-8) characters.
+static constexpr std::string_view manifest_magic = "LANGMANI";
+static constexpr uint32_t         manifest_version = 2;
+
+namespace {
+
+class Reader {
+  public:
+    explicit Reader(std::string_view data) : _data(data) {}
+
+    template<typename T>
+    bool read(T& value) {
+        if(_data.size() < sizeof(T))
+            return false;
+        std::memcpy(&value, _data.data(), sizeof(T));
+        _data.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool read(std::filesystem::path& path) {
+        uint32_t length = 0;
+        if(!read(length) || _data.size() < length)
+            return false;
+        const auto str = _data.substr(0, length);
+        path = std::u8string(reinterpret_cast<const char8_t*>(str.data()), str.size());
+        _data.remove_prefix(length);
+        return true;
+    }
+
+    bool read(std::string_view& str, size_t length) {
+        if(_data.size() < length)
+            return false;
+        str = _data.substr(0, length);
+        _data.remove_prefix(length);
+        return true;
+    }
+
+  private:
+    std::string_view _data;
+};
+
+class Writer {
+  public:
+    template<typename T>
+    void write(const T& value) {
+        _data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write(const std::filesystem::path& path) {
+        const auto str = path.u8string();
+        write(static_cast<uint32_t>(str.size()));
+        _data.append(reinterpret_cast<const char*>(str.data()), str.size());
+    }
+
+    void write(std::string_view str) { _data.append(str); }
+
+    const std::string& data() const { return _data; }
+
+  private:
+    std::string _data;
+};
+
+// Size and modification time of a file, std::nullopt if it cannot be accessed.
+std::optional<std::pair<uintmax_t, int64_t>> stat_file(const std::filesystem::path& path) {
+    std::error_code ec;
+    const auto      size = std::filesystem::file_size(path, ec);
+    if(ec)
+        return std::nullopt;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    if(ec)
+        return std::nullopt;
+    return std::pair{size, static_cast<int64_t>(time.time_since_epoch().count())};
+}
+
+} // namespace
+
+bool BuildManifest::load(const std::filesystem::path& path) {
+    std::lock_guard lock(_mutex);
+    _records.clear();
+    _checked.clear();
+    _dirty = false;
+
+    if(!std::filesystem::exists(path))
+        return true;
+    MappedFile file;
+    if(!file.open(path)) {
+        warn("[BuildManifest] Could not open build manifest {}.\n", path.string());
+        return false;
+    }
+
+    Reader           reader(file.view());
+    std::string_view magic;
+    uint32_t         version = 0;
+    uint32_t         count = 0;
+    if(!reader.read(magic, manifest_magic.size()) || magic != manifest_magic || !reader.read(version) || version != manifest_version || !reader.read(count)) {
+        warn("[BuildManifest] Ignoring build manifest {} (Incompatible format).\n", path.string());
+        return false;
+    }
+
+    _records.reserve(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        std::filesystem::path source;
+        Record                record;
+        uint32_t              dependency_count = 0;
+        if(!reader.read(source) || !reader.read(record.source_size) || !reader.read(record.source_time) || !reader.read(record.source_hash) ||
+           !reader.read(record.inputs_hash) || !reader.read(record.interface_hash) || !reader.read(record.object) || !reader.read(dependency_count)) {
+            warn("[BuildManifest] Ignoring truncated build manifest {}.\n", path.string());
+            _records.clear();
+            return false;
+        }
+        record.dependencies.resize(dependency_count);
+        bool complete = true;
+        for(auto& dependency : record.dependencies)
+            complete = complete && reader.read(dependency);
+        uint32_t probe_count = 0;
+        complete = complete && reader.read(probe_count);
+        if(complete)
+            record.probes.resize(probe_count);
+        for(auto& [probe, existed] : record.probes) {
+            uint8_t existed_byte = 0;
+            complete = complete && reader.read(probe) && reader.read(existed_byte);
+            existed = existed_byte != 0;
+        }
+        if(!complete) {
+            warn("[BuildManifest] Ignoring truncated build manifest {}.\n", path.string());
+            _records.clear();
+            return false;
+        }
+        _records.emplace(std::move(source), std::move(record));
+    }
+    return true;
+}
+
+bool BuildManifest::save(const std::filesystem::path& path) {
+    std::lock_guard lock(_mutex);
+    if(!_dirty)
+        return true;
+
+    Writer writer;
+    writer.write(manifest_magic);
+    writer.write(manifest_version);
+    writer.write(static_cast<uint32_t>(_records.size()));
+    for(const auto& [source, record] : _records) {
+        writer.write(source);
+        writer.write(record.source_size);
+        writer.write(record.source_time);
+        writer.write(record.source_hash);
+        writer.write(record.inputs_hash);
+        writer.write(record.interface_hash);
+        writer.write(record.object);
+        writer.write(static_cast<uint32_t>(record.dependencies.size()));
+        for(const auto& dependency : record.dependencies)
+            writer.write(dependency);
+        writer.write(static_cast<uint32_t>(record.probes.size()));
+        for(const auto& [probe, existed] : record.probes) {
+            writer.write(probe);
+            writer.write(static_cast<uint8_t>(existed));
+        }
+    }
+
+    // Another compiler instance may be reading it.
+    const auto temporary_path = make_temporary_path(path);
+    {
+        std::ofstream file(temporary_path, std::ios::binary);
+        file.write(writer.data().data(), writer.data().size());
+        if(!file) {
+            error("[BuildManifest] Could not write build manifest {}.\n", temporary_path.string());
+            return false;
+        }
+    }
+    if(!commit_temporary_file(temporary_path, path)) {
+        error("[BuildManifest] Could not write build manifest {}.\n", path.string());
+        return false;
+    }
+    _dirty = false;
+    return true;
+}
+
+std::optional<BuildManifest::Record> BuildManifest::find(const std::filesystem::path& path) {
+    std::lock_guard lock(_mutex);
+    if(auto it = _records.find(path); it != _records.end())
+        return it->second;
+    return std::nullopt;
+}
+
+std::optional<BuildManifest::Record> BuildManifest::find_unchanged(const std::filesystem::path& path) {
+    std::optional<Record> record;
+    {
+        std::lock_guard lock(_mutex);
+        if(auto it = _checked.find(path); it != _checked.end())
+            return it->second;
+        if(auto it = _records.find(path); it != _records.end())
+            record = it->second;
+    }
+
+    // Stat outside of the lock: Files are checked concurrently by the worker threads.
+    if(record) {
+        const auto stat = stat_file(path);
+        if(!stat || stat->first != record->source_size || stat->second != record->source_time)
+            record.reset();
+    }
+
+    std::lock_guard lock(_mutex);
+    _checked.emplace(path, record);
+    return record;
+}
+
+bool BuildManifest::probes_unchanged(const Record& record) {
+    for(const auto& [probe, existed] : record.probes) {
+        std::optional<bool> exists;
+        {
+            std::lock_guard lock(_mutex);
+            if(auto it = _probed.find(probe); it != _probed.end())
+                exists = it->second;
+        }
+        if(!exists) {
+            // Outside of the lock, as in find_unchanged.
+            std::error_code ec;
+            exists = std::filesystem::exists(probe, ec);
+            std::lock_guard lock(_mutex);
+            _probed.emplace(probe, *exists);
+        }
+        if(*exists != existed)
+            return false;
+    }
+    return true;
+}
+
+bool BuildManifest::read_file_status(const std::filesystem::path& path, Record& record) {
+    const auto stat = stat_file(path);
+    if(!stat)
+        return false;
+    record.source_size = stat->first;
+    record.source_time = stat->second;
+    return true;
+}
+
+void BuildManifest::update(const std::filesystem::path& path, Record record) {
+    std::lock_guard lock(_mutex);
+    _checked[path] = record;
+    _records[path] = std::move(record);
+    _dirty = true;
+}
+
+void BuildManifest::new_run() {
+    std::lock_guard lock(_mutex);
+    _checked.clear();
+    _probed.clear();
+    _up_to_date_count = 0;
+}
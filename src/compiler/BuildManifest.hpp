@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Persistent record of the last successful processing of each module, in a single binary file.
+// When a source file has the same size and modification time as recorded, its hash and dependencies are known
+// without reading, tokenizing or hashing it: A null build only costs a stat per source file.
+class BuildManifest {
+  public:
+    struct Record {
+        uintmax_t                          source_size = 0;
+        int64_t                            source_time = 0;
+        uint64_t                           source_hash = 0;
+        uint64_t                           inputs_hash = 0;
+        uint64_t                           interface_hash = 0;
+        std::filesystem::path              object;
+        std::vector<std::filesystem::path> dependencies; // Resolved absolute paths.
+        // Files looked for while resolving the imports, and whether they existed (see resolve_dependency).
+        std::vector<std::pair<std::filesystem::path, bool>> probes;
+    };
+
+    // Returns true on success, a missing manifest is not an error.
+    bool load(const std::filesystem::path& path);
+    // Returns true on success
+    bool save(const std::filesystem::path& path);
+
+    // Returns the last record of path, whether the file changed since or not.
+    std::optional<Record> find(const std::filesystem::path& path);
+    // Returns the record of path if the file didn't change since it was recorded. The file is checked once per run.
+    std::optional<Record> find_unchanged(const std::filesystem::path& path);
+    // Returns true if the files looked for to resolve the imports of record still do (or don't) exist: Otherwise its imports must be resolved again,
+    // a local module may now shadow a standard library one for example. Each file is checked once per run.
+    bool probes_unchanged(const Record& record);
+    // Records the processing of path. Size and modification time must have been read (see read_file_status) before reading the file itself,
+    // so a modification made while processing it is not missed.
+    void update(const std::filesystem::path& path, Record record);
+    // Fills the size and modification time of record. Returns true on success.
+    static bool read_file_status(const std::filesystem::path& path, Record& record);
+    // Forgets the results of the file checks, should be called at the start of each run.
+    void new_run();
+
+    size_t up_to_date_count() const { return _up_to_date_count; }
+    void   mark_as_up_to_date() { ++_up_to_date_count; }
+
+  private:
+    std::mutex                                                       _mutex;
+    std::unordered_map<std::filesystem::path, Record>                _records;
+    std::unordered_map<std::filesystem::path, std::optional<Record>> _checked; // Results of find_unchanged for this run.
+    std::unordered_map<std::filesystem::path, bool>                  _probed;  // Existence of the probed files for this run.
+    bool                                                             _dirty = false;
+    std::atomic<size_t>                                              _up_to_date_count = 0;
+};
@@ -1,75 +1,214 @@
 #include <DependencyTree.hpp>
 
+#include <algorithm>
+#include <queue>
+
+#include <Hash.hpp>
 #include <ModuleInterface.hpp>
 #include <Parser.hpp>
-#include <Tokenizer.hpp>
 
-bool DependencyTree::construct(const std::filesystem::path& path) {
-    const auto abs_path = std::filesystem::absolute(path).lexically_normal();
-    _roots.insert(abs_path);
-    return construct(abs_path, nullptr);
+bool DependencyTree::construct(const std::vector<std::filesystem::path>& paths, ThreadPool* pool) {
+    {
+        std::lock_guard lock(_mutex);
+        _pool = pool;
+        _failed = false;
+        for(const auto& path : paths) {
+            const auto abs_path = std::filesystem::absolute(path).lexically_normal();
+            _roots.insert(abs_path);
+            schedule_scan(abs_path);
+        }
+    }
+
+    if(pool) {
+        std::unique_lock lock(_mutex);
+        _done_condition.wait(lock, [this] { return _scans_in_flight == 0; });
+    } else {
+        while(true) {
+            std::function<void()> task;
+            {
+                std::lock_guard lock(_mutex);
+                if(_pending_scans.empty())
+                    break;
+                task = std::move(_pending_scans.back());
+                _pending_scans.pop_back();
+            }
+            task();
+        }
+    }
+
+    std::lock_guard lock(_mutex);
+    _pool = nullptr;
+    return !_failed;
 }
 
-bool DependencyTree::construct(const std::filesystem::path& path, const File* from) {
-    File& current_file = _files[path];
-    current_file.path = path.lexically_normal();
-    if(from)
-        current_file.necessary_for.insert(from->path);
+std::unique_ptr<DependencyTree::Scan> DependencyTree::take_scan(const std::filesystem::path& path) {
+    std::lock_guard lock(_mutex);
+    if(auto it = _files.find(path); it != _files.end())
+        return std::move(it->second.scan);
+    return nullptr;
+}
 
-    std ::ifstream input_file(path);
-    if(!input_file) {
-        error("[DependencyTree::construct] Couldn't open file '{}' (Running from {}).\n", path.string(), std::filesystem::current_path().string());
-        return false;
-    }
-    std::string source{(std::istreambuf_iterator<char>(input_file)), std::istreambuf_iterator<char>()};
+void DependencyTree::schedule_scan(const std::filesystem::path& path) {
+    if(_files.contains(path))
+        return;
+    _files[path].path = path.lexically_normal();
+    ++_scans_in_flight;
+    auto task = [this, path] { run_scan(path); };
+    if(_pool)
+        _pool->submit(task);
+    else
+        _pending_scans.push_back(task);
+}
+
+void DependencyTree::add_dependency(const std::filesystem::path& path, const std::filesystem::path& dependency) {
+    std::lock_guard lock(_mutex);
+    _files[path].depends_on.insert(dependency);
+    schedule_scan(dependency);
+    _files[dependency].necessary_for.insert(path);
+}
+
+void DependencyTree::add_probes(const std::vector<std::pair<std::filesystem::path, bool>>& probes) {
+    for(const auto& [probe, existed] : probes)
+        _probed_files.insert(probe);
+}
+
+void DependencyTree::finish_scan(bool success) {
+    std::lock_guard lock(_mutex);
+    if(!success)
+        _failed = true;
+    if(--_scans_in_flight == 0)
+        _done_condition.notify_all();
+}
 
-    std::vector<Token> tokens;
+void DependencyTree::run_scan(const std::filesystem::path& path) {
+    // Whatever happens, the scan must be accounted for: construct waits for all of them.
+    bool success = false;
     try {
-        Tokenizer tokenizer(source);
-        while(tokenizer.has_more())
-            tokens.push_back(tokenizer.consume());
+        success = scan(path);
     } catch(const Exception& e) {
-        error("[DependencyTree::construct] Error tokenizing '{}':\n", path.string());
+        error("[DependencyTree::construct] Error scanning '{}':\n", path.string());
         e.display();
+    } catch(const std::exception& e) {
+        error("[DependencyTree::construct] Error scanning '{}': {}\n", path.string(), e.what());
+    } catch(...) {
+        error("[DependencyTree::construct] Unknown error scanning '{}'.\n", path.string());
+    }
+    finish_scan(success);
+}
+
+bool DependencyTree::scan(const std::filesystem::path& path) {
+    // The recorded dependencies are only valid if the imports still resolve to the same files.
+    if(_manifest) {
+        if(const auto record = _manifest->find_unchanged(path); record && _manifest->probes_unchanged(*record)) {
+            for(const auto& dep : record->dependencies)
+                add_dependency(path, dep);
+            std::lock_guard lock(_mutex);
+            add_probes(record->probes);
+            return true;
+        }
+    }
+
+    auto result = std::make_unique<Scan>();
+    BuildManifest::read_file_status(path, result->file_status);
+    result->source = SourceManager::instance().load(path);
+    if(!result->source) {
+        error("[DependencyTree::construct] Couldn't open file '{}' (Running from {}).\n", path.string(), std::filesystem::current_path().string());
         return false;
     }
+    result->file_status.source_hash = hash_bytes(result->source->content());
 
-    Parser parser;
-    parser.set_source(source);
-    auto dependencies = parser.parse_dependencies(tokens);
-
-    for(const auto& dep : dependencies) {
-        auto resolved_path = resolve_dependency(current_file.path.parent_path(), dep);
-        current_file.depends_on.insert(resolved_path);
-        if(!construct(resolved_path, &current_file))
-            return false;
+    // Touched (checkout, copy...) but not modified: No need to tokenize it to know its dependencies.
+    if(_manifest) {
+        if(const auto record = _manifest->find(path); record && record->source_hash == result->file_status.source_hash && _manifest->probes_unchanged(*record)) {
+            for(const auto& dep : record->dependencies)
+                add_dependency(path, dep);
+            result->file_status.probes = record->probes;
+            std::lock_guard lock(_mutex);
+            add_probes(result->file_status.probes);
+            _files[path].scan = std::move(result);
+            return true;
+        }
     }
 
+    // Dependencies are scheduled as soon as their import is found.
+    Parser parser;
+    parser.parse_dependencies(*result->source,
+                              [&](const std::string& dep) { add_dependency(path, resolve_dependency(path.parent_path(), dep, &result->file_status.probes)); });
+
+    std::lock_guard lock(_mutex);
+    add_probes(result->file_status.probes);
+    _files[path].scan = std::move(result);
     return true;
 }
 
-// Note: Could be easily optimized.
-ErrorOr<std::vector<std::vector<std::filesystem::path>>> DependencyTree::generate_processing_stages() const {
-    auto deps_copy = _files;
+ErrorOr<DependencyTree::ProcessingGraph> DependencyTree::generate_processing_graph(const CostFunction& cost) const {
+    ProcessingGraph graph;
+
+    // Sorted paths give stable indices, and thus a deterministic schedule.
+    graph.files.reserve(_files.size());
+    for(const auto& [path, file] : _files)
+        graph.files.push_back(path);
+    std::sort(graph.files.begin(), graph.files.end());
 
-    std::vector<std::vector<std::filesystem::path>> result;
+    std::unordered_map<std::filesystem::path, size_t> indices;
+    indices.reserve(graph.files.size());
+    for(size_t i = 0; i < graph.files.size(); ++i)
+        indices.emplace(graph.files[i], i);
 
-    while(!deps_copy.empty()) {
-        auto& ready = result.emplace_back();
-        for(const auto& file : deps_copy) {
-            if(file.second.depends_on.empty())
-                ready.push_back(file.first);
+    graph.dependencies.resize(graph.size());
+    graph.dependents.resize(graph.size());
+    graph.dependencies_count.resize(graph.size(), 0);
+    for(size_t i = 0; i < graph.size(); ++i) {
+        for(const auto& dependency : _files.at(graph.files[i]).depends_on) {
+            auto it = indices.find(dependency);
+            if(it == indices.end())
+                return Error("Dependency missing from the dependency tree.");
+            graph.dependencies[i].push_back(it->second);
+            graph.dependents[it->second].push_back(i);
+            ++graph.dependencies_count[i];
         }
+    }
 
-        if(ready.empty())
-            return Error("Cyclic dependency detected.");
+    // Kahn's algorithm
+    std::vector<size_t> topological_order;
+    topological_order.reserve(graph.size());
+    auto remaining_dependencies = graph.dependencies_count;
+    for(size_t i = 0; i < graph.size(); ++i)
+        if(remaining_dependencies[i] == 0)
+            topological_order.push_back(i);
+    for(size_t head = 0; head < topological_order.size(); ++head)
+        for(const auto dependent : graph.dependents[topological_order[head]])
+            if(--remaining_dependencies[dependent] == 0)
+                topological_order.push_back(dependent);
 
-        for(const auto& path : ready) {
-            for(const auto& depending : deps_copy[path].necessary_for)
-                deps_copy[depending].depends_on.erase(path);
-            deps_copy.erase(path);
-        }
+    if(topological_order.size() != graph.size())
+        return Error("Cyclic dependency detected.");
+
+    // Critical path: Walk the nodes in reverse topological order, all dependents of a node are then already known.
+    graph.priorities.resize(graph.size(), 0.0);
+    for(auto it = topological_order.rbegin(); it != topological_order.rend(); ++it) {
+        double longest_chain = 0.0;
+        for(const auto dependent : graph.dependents[*it])
+            longest_chain = std::max(longest_chain, graph.priorities[dependent]);
+        graph.priorities[*it] = (cost ? cost(graph.files[*it]) : 1.0) + longest_chain;
+    }
+
+    // Order in which a single worker would process the nodes.
+    const auto compare = [&graph](size_t lhs, size_t rhs) { return graph.lower_priority(lhs, rhs); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(compare)> ready(compare);
+    remaining_dependencies = graph.dependencies_count;
+    for(size_t i = 0; i < graph.size(); ++i)
+        if(remaining_dependencies[i] == 0)
+            ready.push(i);
+    graph.order.reserve(graph.size());
+    while(!ready.empty()) {
+        const auto node = ready.top();
+        ready.pop();
+        graph.order.push_back(node);
+        for(const auto dependent : graph.dependents[node])
+            if(--remaining_dependencies[dependent] == 0)
+                ready.push(dependent);
     }
 
-    return result;
-}
\ No newline at end of file
+    return graph;
+}
@@ -1,25 +1,87 @@
 #pragma once
 
+#include <condition_variable>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include <BuildManifest.hpp>
 #include <Error.hpp>
+#include <Source.hpp>
+#include <ThreadPool.hpp>
 
 class DependencyTree {
   public:
+    // Result of the scan of a file, kept so it is read only once. Its tokens are not: They are streamed again by the parser, rather than held for the whole build.
+    struct Scan {
+        BuildManifest::Record             file_status; // Size and modification time of the file before it was read, hash of its content and resolution probes.
+        std::shared_ptr<const SourceFile> source;      // Shared with the parsing, the codegen and the diagnostics of the file.
+    };
+
     struct File {
         std::filesystem::path           path;
         std::set<std::filesystem::path> depends_on;
         std::set<std::filesystem::path> necessary_for;
+        std::unique_ptr<Scan>           scan; // Not set if the dependencies were known from the manifest.
+    };
+
+    // Indexed view of the tree used for scheduling: A file can be processed as soon as all of its dependencies are.
+    struct ProcessingGraph {
+        std::vector<std::filesystem::path> files;              // Node index -> File path
+        std::vector<std::vector<size_t>>   dependencies;       // Nodes this one imports
+        std::vector<std::vector<size_t>>   dependents;         // Nodes waiting on this one
+        std::vector<size_t>                dependencies_count; // Number of dependencies (in-degree) of each node
+        std::vector<double>                priorities;         // Cost of the longest chain of dependents, including the node itself (critical path)
+        std::vector<size_t>                order;              // Topological order, highest priority first among ready nodes
+
+        size_t size() const { return files.size(); }
+        // Orders ready nodes: Highest priority first, ties are broken by index to keep the scheduling deterministic.
+        bool   lower_priority(size_t lhs, size_t rhs) const { return priorities[lhs] < priorities[rhs] || (priorities[lhs] == priorities[rhs] && lhs > rhs); }
     };
 
-    bool                                                     construct(const std::filesystem::path& path);
-    ErrorOr<std::vector<std::vector<std::filesystem::path>>> generate_processing_stages() const;
+    using CostFunction = std::function<double(const std::filesystem::path&)>;
+
+    // When set, dependencies of unmodified files are read from the manifest rather than by scanning them.
+    // Files are considered unmodified if their size and modification time, or their content hash, didn't change.
+    void set_manifest(BuildManifest* manifest) { _manifest = manifest; }
+
+    // Scans the files and, recursively, their dependencies. Files are read and tokenized on the pool if provided.
+    // Returns true on success
+    bool construct(const std::vector<std::filesystem::path>& paths, ThreadPool* pool = nullptr);
+    // Hands over the scan result of path, nullptr if it wasn't scanned (or was already taken).
+    std::unique_ptr<Scan> take_scan(const std::filesystem::path& path);
+    // Files looked for while resolving the imports, existing or not: Adding or removing one of them may change the tree.
+    const std::set<std::filesystem::path>& probed_files() const { return _probed_files; }
+    // cost estimates the processing time of a file, every file has the same cost if not provided.
+    ErrorOr<ProcessingGraph> generate_processing_graph(const CostFunction& cost = {}) const;
 
   private:
     std::set<std::filesystem::path>                 _roots;
     std::unordered_map<std::filesystem::path, File> _files;
+    BuildManifest*                                  _manifest = nullptr;
+    std::set<std::filesystem::path>                 _probed_files;
+
+    // State of the on-going construction
+    std::mutex                         _mutex;
+    std::condition_variable            _done_condition;
+    ThreadPool*                        _pool = nullptr;
+    std::vector<std::function<void()>> _pending_scans; // Serial construction: Scans waiting to be run.
+    size_t                             _scans_in_flight = 0;
+    bool                               _failed = false;
 
-    bool construct(const std::filesystem::path& path, const File* from);
+    // Adds the path to the tree and schedules its scan if it is new. Must be called with _mutex held.
+    void schedule_scan(const std::filesystem::path& path);
+    // Scans path and calls finish_scan, even if the scan throws.
+    void run_scan(const std::filesystem::path& path);
+    // Returns true on success
+    bool scan(const std::filesystem::path& path);
+    void add_dependency(const std::filesystem::path& path, const std::filesystem::path& dependency);
+    // Must be called with _mutex held.
+    void add_probes(const std::vector<std::pair<std::filesystem::path, bool>>& probes);
+    void finish_scan(bool success);
 };
@@ -0,0 +1,268 @@
+#include <ExecutableBenchmark.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+#include <fmt/format.h>
+
+#include <Logger.hpp>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+extern char** environ;
+#endif
+
+#ifdef WIN32
+namespace {
+double to_milliseconds(const FILETIME& time) { // In 100ns intervals.
+    return static_cast<double>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10000.0;
+}
+
+// See "Everyone quotes command line arguments the wrong way" (CommandLineToArgvW rules).
+std::string quote_argument(const std::string& arg) {
+    if(!arg.empty() && arg.find_first_of(" \t\n\v\"") == std::string::npos)
+        return arg;
+    std::string r = "\"";
+    size_t      backslashes = 0;
+    for(const auto c : arg) {
+        if(c == '\\') {
+            ++backslashes;
+            continue;
+        }
+        r.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        backslashes = 0;
+        r += c;
+    }
+    r.append(backslashes * 2, '\\');
+    return r + "\"";
+}
+} // namespace
+
+std::optional<RunMeasure> run_measured(const std::filesystem::path& executable, const std::vector<std::string>& arguments, bool quiet) {
+    auto command_line = quote_argument(executable.string());
+    for(const auto& arg : arguments)
+        command_line += " " + quote_argument(arg);
+
+    SECURITY_ATTRIBUTES security_attributes{.nLength = sizeof(SECURITY_ATTRIBUTES), .lpSecurityDescriptor = nullptr, .bInheritHandle = TRUE};
+    HANDLE              null_output = quiet ? CreateFileA("NUL", GENERIC_WRITE, FILE_SHARE_WRITE, &security_attributes, OPEN_EXISTING, 0, nullptr) : INVALID_HANDLE_VALUE;
+    STARTUPINFOA        startup_info{.cb = sizeof(STARTUPINFOA)};
+    if(null_output != INVALID_HANDLE_VALUE) {
+        startup_info.dwFlags = STARTF_USESTDHANDLES;
+        startup_info.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        startup_info.hStdOutput = null_output;
+        startup_info.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    }
+    PROCESS_INFORMATION process_info;
+    const auto          start = std::chrono::steady_clock::now();
+    const auto          created = CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, null_output != INVALID_HANDLE_VALUE, 0, nullptr, nullptr, &startup_info, &process_info);
+    if(null_output != INVALID_HANDLE_VALUE)
+        CloseHandle(null_output);
+    if(!created)
+        return std::nullopt;
+    WaitForSingleObject(process_info.hProcess, INFINITE);
+    const auto end = std::chrono::steady_clock::now();
+
+    RunMeasure measure;
+    measure.wall_time = std::chrono::duration<double, std::milli>(end - start).count();
+    DWORD exit_code = 0;
+    GetExitCodeProcess(process_info.hProcess, &exit_code);
+    measure.exit_code = static_cast<int>(exit_code);
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if(GetProcessTimes(process_info.hProcess, &creation_time, &exit_time, &kernel_time, &user_time)) {
+        measure.user_time = to_milliseconds(user_time);
+        measure.system_time = to_milliseconds(kernel_time);
+    }
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(process_info.hProcess, &counters, sizeof(counters))) {
+        measure.max_rss = static_cast<int64_t>(counters.PeakWorkingSetSize);
+        measure.minor_faults = static_cast<int64_t>(counters.PageFaultCount);
+    }
+    CloseHandle(process_info.hThread);
+    CloseHandle(process_info.hProcess);
+    return measure;
+}
+#else
+std::optional<RunMeasure> run_measured(const std::filesystem::path& executable, const std::vector<std::string>& arguments, bool quiet) {
+    const auto         executable_str = executable.string();
+    std::vector<char*> argv{const_cast<char*>(executable_str.c_str())};
+    for(const auto& arg : arguments)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    if(quiet)
+        posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t      pid;
+    const auto start = std::chrono::steady_clock::now();
+    const auto spawn_error = posix_spawn(&pid, executable_str.c_str(), &file_actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    if(spawn_error != 0)
+        return std::nullopt;
+
+    int    status = 0;
+    rusage usage;
+    pid_t  waited;
+    while((waited = wait4(pid, &status, 0, &usage)) == -1 && errno == EINTR)
+        ;
+    const auto end = std::chrono::steady_clock::now();
+    if(waited != pid)
+        return std::nullopt;
+
+    const auto to_milliseconds = [](const timeval& time) { return static_cast<double>(time.tv_sec) * 1000.0 + static_cast<double>(time.tv_usec) / 1000.0; };
+    RunMeasure measure;
+    measure.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status); // Same convention as the shells for signals.
+    measure.wall_time = std::chrono::duration<double, std::milli>(end - start).count();
+    measure.user_time = to_milliseconds(usage.ru_utime);
+    measure.system_time = to_milliseconds(usage.ru_stime);
+    // The peak of the child starts at the one of its parent (shared or copied address space until execve): It is only meaningful above ours.
+    rusage self_usage;
+    if(getrusage(RUSAGE_SELF, &self_usage) == 0 && usage.ru_maxrss > self_usage.ru_maxrss)
+#ifdef __APPLE__
+        measure.max_rss = static_cast<int64_t>(usage.ru_maxrss); // In bytes on macOS.
+#else
+        measure.max_rss = static_cast<int64_t>(usage.ru_maxrss) * 1024; // In KiB on Linux.
+#endif
+    measure.minor_faults = static_cast<int64_t>(usage.ru_minflt);
+    measure.major_faults = static_cast<int64_t>(usage.ru_majflt);
+    return measure;
+}
+#endif
+
+Statistics compute_statistics(std::vector<double> samples) {
+    Statistics r;
+    if(samples.empty())
+        return r;
+    std::sort(samples.begin(), samples.end());
+    // Linear interpolation between the closest ranks.
+    const auto percentile = [&](double p) {
+        const auto rank = p * static_cast<double>(samples.size() - 1);
+        const auto lower = static_cast<size_t>(rank);
+        const auto upper = std::min(lower + 1, samples.size() - 1);
+        return samples[lower] + (samples[upper] - samples[lower]) * (rank - static_cast<double>(lower));
+    };
+    r.min = samples.front();
+    r.max = samples.back();
+    r.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    r.median = percentile(0.5);
+    r.p95 = percentile(0.95);
+    if(samples.size() > 1 && r.mean != 0) {
+        double sum_of_squares = 0;
+        for(const auto sample : samples)
+            sum_of_squares += (sample - r.mean) * (sample - r.mean);
+        r.cv = std::sqrt(sum_of_squares / static_cast<double>(samples.size() - 1)) / r.mean;
+    }
+    return r;
+}
+
+bool ExecutableBenchmark::run(size_t count) {
+    runs.clear();
+    for(size_t i = 0; i < warmup_runs + count; ++i) {
+        auto measure = run_measured(executable, arguments, true);
+        if(!measure) {
+            error("[Benchmark] Could not run '{}'.\n", executable.string());
+            return false;
+        }
+        if(i >= warmup_runs) {
+            if(!runs.empty() && measure->exit_code != runs.front().exit_code)
+                warn("[Benchmark] Run {} returned {}, the first run returned {}.\n", runs.size() + 1, measure->exit_code, runs.front().exit_code);
+            runs.push_back(*measure);
+        }
+    }
+    return true;
+}
+
+namespace {
+struct Metric {
+    const char*                              name;
+    const char*                              json_name;
+    const char*                              unit;
+    double                                   scale; // From the measure to the unit.
+    std::function<double(const RunMeasure&)> get;
+    bool                                     zero_if_unknown = false;
+};
+
+const std::vector<Metric>& get_metrics() {
+    static const std::vector<Metric> metrics{
+        {"Wall time", "wall_time_ms", "ms", 1.0, [](const RunMeasure& m) { return m.wall_time; }},
+        {"User time", "user_time_ms", "ms", 1.0, [](const RunMeasure& m) { return m.user_time; }},
+        {"System time", "system_time_ms", "ms", 1.0, [](const RunMeasure& m) { return m.system_time; }},
+        {"Max RSS", "max_rss_mib", "MiB", 1.0 / (1024.0 * 1024.0), [](const RunMeasure& m) { return static_cast<double>(m.max_rss); }, true},
+        {"Minor page faults", "minor_faults", "", 1.0, [](const RunMeasure& m) { return static_cast<double>(m.minor_faults); }},
+        {"Major page faults", "major_faults", "", 1.0, [](const RunMeasure& m) { return static_cast<double>(m.major_faults); }},
+    };
+    return metrics;
+}
+
+// Empty if the metric is unknown for any of the runs.
+std::vector<double> get_samples(const std::vector<RunMeasure>& runs, const Metric& metric) {
+    std::vector<double> r;
+    for(const auto& run : runs) {
+        const auto value = metric.get(run);
+        if(metric.zero_if_unknown && value == 0)
+            return {};
+        r.push_back(value * metric.scale);
+    }
+    return r;
+}
+
+std::string escape(const std::string& str) {
+    std::string r;
+    for(const auto c : str) {
+        if(c == '"' || c == '\\')
+            r += '\\';
+        r += c;
+    }
+    return r;
+}
+} // namespace
+
+std::string ExecutableBenchmark::text_report() const {
+    std::string r = fmt::format(" {} runs of {} ({} warmup), returned {}.\n", runs.size(), executable.string(), warmup_runs, runs.empty() ? 0 : runs.front().exit_code);
+    r += fmt::format(" {:<18} | {:>12} | {:>12} | {:>12} | {:>12} | {:>7}\n", "Metric", "Median", "p95", "Min", "Max", "CV");
+    for(const auto& metric : get_metrics()) {
+        const auto samples = get_samples(runs, metric);
+        if(samples.empty()) {
+            r += fmt::format(" {:<18} | {:>12} | {:>12} | {:>12} | {:>12} | {:>7}\n", metric.name, "n/a", "n/a", "n/a", "n/a", "n/a");
+            continue;
+        }
+        const auto stats = compute_statistics(samples);
+        const auto value = [&](double v) { return fmt::format("{:.2f}{}", v, metric.unit); };
+        r += fmt::format(" {:<18} | {:>12} | {:>12} | {:>12} | {:>12} | {:>6.2f}%\n", metric.name, value(stats.median), value(stats.p95), value(stats.min), value(stats.max),
+                         stats.cv * 100.0);
+    }
+    if(!runs.empty() && runs.front().max_rss == 0)
+        r += " Max RSS: Below the peak of the compiler itself, which is inherited by the processes it creates.\n";
+    return r;
+}
+
+std::string ExecutableBenchmark::json_report() const {
+    std::string r = fmt::format(R"({{"executable":"{}","runs":{},"warmup_runs":{},"exit_code":{},"metrics":{{)", escape(executable.string()), runs.size(), warmup_runs,
+                                runs.empty() ? 0 : runs.front().exit_code);
+    bool first = true;
+    for(const auto& metric : get_metrics()) {
+        const auto samples = get_samples(runs, metric);
+        if(samples.empty()) {
+            r += fmt::format(R"({}"{}":null)", first ? "" : ",", metric.json_name);
+            first = false;
+            continue;
+        }
+        const auto stats = compute_statistics(samples);
+        r += fmt::format(R"({}"{}":{{"median":{:.6g},"p95":{:.6g},"min":{:.6g},"max":{:.6g},"mean":{:.6g},"cv":{:.6g},"samples":[{:.6g}]}})", first ? "" : ",", metric.json_name,
+                         stats.median, stats.p95, stats.min, stats.max, stats.mean, stats.cv, fmt::join(samples, ","));
+        first = false;
+    }
+    return r + "}}\n";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Resources used by one run of an executable.
+struct RunMeasure {
+    int     exit_code = 0;
+    double  wall_time = 0;    // In milliseconds.
+    double  user_time = 0;    // CPU time, in milliseconds.
+    double  system_time = 0;  // CPU time, in milliseconds.
+    int64_t max_rss = 0;      // Peak resident set size, in bytes. 0 if unknown: On POSIX systems, only a peak above the one of the compiler itself can be measured.
+    int64_t minor_faults = 0; // Page faults serviced without I/O. On Windows: All page faults.
+    int64_t major_faults = 0; // Page faults requiring I/O. Not available on Windows.
+};
+
+// Runs executable with arguments (without going through a shell) and waits for its completion.
+// quiet: Discard the standard output of the executable.
+// Returns nullopt if it could not be started.
+std::optional<RunMeasure> run_measured(const std::filesystem::path& executable, const std::vector<std::string>& arguments, bool quiet);
+
+struct Statistics {
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double median = 0;
+    double p95 = 0;
+    double cv = 0; // Coefficient of variation: Standard deviation relative to the mean.
+};
+
+Statistics compute_statistics(std::vector<double> samples);
+
+struct ExecutableBenchmark {
+    std::filesystem::path    executable;
+    std::vector<std::string> arguments;
+    size_t                   warmup_runs = 1; // Not measured: Populate the file system cache, train the branch predictors...
+    std::vector<RunMeasure>  runs;
+
+    // Returns true on success
+    bool run(size_t count);
+
+    std::string text_report() const;
+    std::string json_report() const;
+};
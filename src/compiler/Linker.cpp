@@ -0,0 +1,182 @@
+#include <Linker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <set>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <Logger.hpp>
+#include <TimeTrace.hpp>
+
+#include <llvm/BinaryFormat/Magic.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+
+std::optional<LTOMode> parse_lto_mode(std::string_view str) {
+    if(str == "none")
+        return LTOMode::None;
+    if(str == "thin")
+        return LTOMode::Thin;
+    if(str == "full")
+        return LTOMode::Full;
+    return std::nullopt;
+}
+
+std::string_view to_string(LTOMode mode) {
+    switch(mode) {
+        case LTOMode::None: return "none";
+        case LTOMode::Thin: return "thin";
+        case LTOMode::Full: return "full";
+    }
+    return "none";
+}
+
+// Returns true on success
+static bool link_with_driver(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output, const LinkOptions& options) {
+    std::string command = "clang";
+    for(const auto& input : inputs)
+        command += " \"" + input.string() + "\"";
+    command += " -o \"" + output.string() + "\"";
+    // Bitcode inputs are merged and optimized by the linker.
+    if(options.lto == LTOMode::Full)
+        command += fmt::format(" -O{} -flto -fuse-ld=lld", options.optimization_level);
+    print("Running '{}'\n", command);
+    if(auto retval = std::system(command.c_str()); retval != 0) {
+        error("Error running clang: {}.\n", retval);
+        return false;
+    }
+    return true;
+}
+
+#ifdef LANG_STUB_POLLY
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Passes/PassPlugin.h>
+
+// The LTO backend registers the extensions LLVM was built with, see CMakeLists.txt.
+llvm::PassPluginLibraryInfo getPollyPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "Polly", LLVM_VERSION_STRING, [](llvm::PassBuilder&) {}};
+}
+#endif
+
+static bool is_bitcode(const std::filesystem::path& path) {
+    llvm::file_magic magic;
+    return !llvm::identify_magic(path.string(), magic) && magic == llvm::file_magic::bitcode;
+}
+
+// ThinLTO backend: Optimizes and generates the native code of each bitcode module in parallel, importing functions from the other
+// modules according to their summaries. The result of each module is cached, keyed on the module and the summaries of what it imports:
+// A modification only re-optimizes the modules it affects.
+// Returns the native object files, std::nullopt on error.
+static std::optional<std::vector<std::filesystem::path>> run_thin_lto(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output,
+                                                                      const LinkOptions& options) {
+    TimeTraceScope trace_scope("ThinLTO", output.string());
+    const auto     report_error = [](llvm::Error err) {
+        error("[Linker] ThinLTO: {}.\n", llvm::toString(std::move(err)));
+        return std::nullopt;
+    };
+
+    llvm::lto::Config config;
+    config.CPU = options.cpu;
+    for(size_t begin = 0; begin < options.features.size();) {
+        const auto end = std::min(options.features.find(',', begin), options.features.size());
+        config.MAttrs.push_back(options.features.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    config.RelocModel = llvm::None; // Same as the modules compiled without LTO.
+    config.OptLevel = options.optimization_level;
+    config.CGOptLevel = options.optimization_level == 0 ? llvm::CodeGenOpt::None : options.optimization_level == 1 ? llvm::CodeGenOpt::Less
+                                                     : options.optimization_level == 2 ? llvm::CodeGenOpt::Default : llvm::CodeGenOpt::Aggressive;
+    config.DefaultTriple = llvm::sys::getDefaultTargetTriple();
+    llvm::lto::LTO lto(std::move(config), llvm::lto::createInProcessThinBackend(llvm::heavyweight_hardware_concurrency(options.jobs)));
+
+    // Symbols are resolved like a linker would: The first definition prevails. Native objects (runtime, C library) may reference
+    // any of them, so none is internalized.
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> buffers;
+    std::set<std::string>                            defined_symbols;
+    for(const auto& input : inputs) {
+        auto buffer = llvm::MemoryBuffer::getFile(input.string());
+        if(!buffer) {
+            error("[Linker] Could not read {}: {}.\n", input.string(), buffer.getError().message());
+            return std::nullopt;
+        }
+        auto file = llvm::lto::InputFile::create((*buffer)->getMemBufferRef());
+        if(!file)
+            return report_error(file.takeError());
+        std::vector<llvm::lto::SymbolResolution> resolutions;
+        for(const auto& symbol : (*file)->symbols()) {
+            auto& resolution = resolutions.emplace_back();
+            resolution.Prevailing = !symbol.isUndefined() && defined_symbols.insert(symbol.getName().str()).second;
+            resolution.VisibleToRegularObj = true;
+        }
+        if(auto err = lto.add(std::move(*file), resolutions))
+            return report_error(std::move(err));
+        buffers.push_back(std::move(*buffer));
+    }
+
+    // Cached results are linked directly from the cache, other outputs (e.g. the combined module of regular LTO) are written next to the cache.
+    std::vector<std::filesystem::path> objects(lto.getMaxTasks());
+    std::atomic<size_t>                hits = 0, misses = 0;
+    auto cache = llvm::localCache("ThinLTO", "Thin", options.lto_cache_directory.string(), [&](unsigned task, std::unique_ptr<llvm::MemoryBuffer> buffer) {
+        objects[task] = buffer->getBufferIdentifier().str();
+    });
+    if(!cache)
+        return report_error(cache.takeError());
+    const llvm::FileCache counting_cache = [&](unsigned task, llvm::StringRef key) -> llvm::Expected<llvm::AddStreamFn> {
+        auto add_stream = (*cache)(task, key);
+        if(add_stream)
+            ++(*add_stream ? misses : hits);
+        return add_stream;
+    };
+    const llvm::AddStreamFn add_stream = [&](unsigned task) -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+        objects[task] = options.lto_cache_directory / fmt::format("{}.lto.{}.o", output.filename().string(), task);
+        std::error_code ec;
+        auto            stream = std::make_unique<llvm::raw_fd_ostream>(objects[task].string(), ec, llvm::sys::fs::OF_None);
+        if(ec)
+            return llvm::errorCodeToError(ec);
+        return std::make_unique<llvm::CachedFileStream>(std::move(stream), objects[task].string());
+    };
+    if(auto err = lto.run(add_stream, counting_cache))
+        return report_error(std::move(err));
+    print("ThinLTO: {} of {} modules re-optimized.\n", misses.load(), misses + hits);
+
+    if(options.lto_cache_size > 0) {
+        auto policy = llvm::parseCachePruningPolicy(fmt::format("cache_size_bytes={}", options.lto_cache_size));
+        if(policy)
+            llvm::pruneCache(options.lto_cache_directory.string(), *policy);
+        else
+            llvm::consumeError(policy.takeError());
+    }
+
+    std::erase_if(objects, [](const auto& object) { return object.empty(); });
+    return objects;
+}
+
+bool link_executable(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output, const LinkOptions& options) {
+    std::vector<std::filesystem::path> link_inputs;
+    auto                               link_options = options;
+    if(options.lto == LTOMode::Thin) {
+        // The linker only sees the native objects produced by our ThinLTO backend.
+        std::vector<std::filesystem::path> bitcode_inputs;
+        std::vector<std::filesystem::path> native_inputs;
+        for(const auto& input : inputs)
+            (is_bitcode(input) ? bitcode_inputs : native_inputs).push_back(input);
+        const auto objects = run_thin_lto(bitcode_inputs, output, options);
+        if(!objects)
+            return false;
+        // Before the native inputs: Archives (e.g. the runtime) only resolve the symbols referenced by the inputs preceding them.
+        link_inputs = *objects;
+        link_inputs.insert(link_inputs.end(), native_inputs.begin(), native_inputs.end());
+        link_options.lto = LTOMode::None;
+    } else
+        link_inputs = inputs;
+    return link_with_driver(link_inputs, output, link_options);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// None: Modules are compiled to native object files, linking only resolves symbols. Fastest, for development builds.
+// Thin: Modules are compiled to bitcode with a summary, optimized across modules in parallel before linking. Results are cached per module.
+// Full: Modules are compiled to bitcode, merged and optimized as a whole by the linker.
+enum class LTOMode {
+    None,
+    Thin,
+    Full,
+};
+
+std::optional<LTOMode> parse_lto_mode(std::string_view str);
+std::string_view       to_string(LTOMode mode);
+
+struct LinkOptions {
+    LTOMode               lto = LTOMode::None;
+    unsigned              optimization_level = 2; // Of the link time optimizations, 0 to 3.
+    std::string           cpu = "generic";        // Target of the link time code generation.
+    std::string           features;
+    std::filesystem::path lto_cache_directory;    // ThinLTO results of each module.
+    uintmax_t             lto_cache_size = 0;     // In bytes, 0: No limit.
+    size_t                jobs = 0;               // ThinLTO backend threads, 0: All hardware threads.
+};
+
+// Links inputs (object or bitcode files) to an executable through the clang driver.
+// Returns true on success
+bool link_executable(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output, const LinkOptions& options);
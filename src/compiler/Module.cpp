@@ -3,6 +3,8 @@
 #include <vector>
 
 #include <GlobalTypeRegistry.hpp>
+#include <TemplateStats.hpp>
+#include <TimeTrace.hpp>
 
 static void dump(auto llvm_object) {
 #ifndef NDEBUG // dump is not available in release builds of LLVM
@@ -16,7 +18,7 @@ static void dump(auto llvm_object) {
     {                                                                                          \
         PrimitiveType::VALUETYPE, [](llvm::IRBuilder<>& ir_builder, llvm::Value* val) { FUNC } \
     }
-static std::unordered_map<Token::Type, std::unordered_map<PrimitiveType, std::function<llvm::Value*(llvm::IRBuilder<>&, llvm::Value*)>>> unary_ops = {
+static const std::unordered_map<Token::Type, std::unordered_map<PrimitiveType, std::function<llvm::Value*(llvm::IRBuilder<>&, llvm::Value*)>>> unary_ops = {
     {Token::Type::Addition,
      {OP(I32, (void)ir_builder; return val;), OP(I8, (void)ir_builder; return val;), OP(I16, (void)ir_builder; return val;), OP(I32, (void)ir_builder; return val;),
       OP(I64, (void)ir_builder; return val;), OP(U8, (void)ir_builder; return val;), OP(U16, (void)ir_builder; return val;), OP(U32, (void)ir_builder; return val;),
@@ -35,7 +37,7 @@ static std::unordered_map<Token::Type, std::unordered_map<PrimitiveType, std::fu
         PrimitiveType::VALUETYPE, [](llvm::IRBuilder<>& ir_builder, llvm::Value* lhs, llvm::Value* rhs) { FUNC } \
     }
 
-static std::unordered_map<Token::Type, std::unordered_map<PrimitiveType, std::function<llvm::Value*(llvm::IRBuilder<>&, llvm::Value*, llvm::Value*)>>> binary_ops = {
+static const std::unordered_map<Token::Type, std::unordered_map<PrimitiveType, std::function<llvm::Value*(llvm::IRBuilder<>&, llvm::Value*, llvm::Value*)>>> binary_ops = {
     {Token::Type::Addition,
      {OP(U8, return ir_builder.CreateAdd(lhs, rhs, "add");), OP(U16, return ir_builder.CreateAdd(lhs, rhs, "add");), OP(U32, return ir_builder.CreateAdd(lhs, rhs, "add");),
       OP(U64, return ir_builder.CreateAdd(lhs, rhs, "add");), OP(I8, return ir_builder.CreateAdd(lhs, rhs, "add");), OP(I16, return ir_builder.CreateAdd(lhs, rhs, "add");),
@@ -291,7 +293,7 @@ llvm::Value* Module::codegen(const AST::Node* node) {
             auto function_name = function_declaration_node->mangled_name();
             auto prev_function = _llvm_module->getFunction(function_name);
             if(prev_function) { // Should be handled by the parser.
-                warn("[Module] Redefinition of function '{}' (line {}).\n", function_name, function_declaration_node->token.line);
+                warn("[Module] Redefinition of function '{}' (line {}).\n", function_name, line_of(function_declaration_node->token));
                 return prev_function;
             }
 
@@ -306,6 +308,7 @@ llvm::Value* Module::codegen(const AST::Node* node) {
             auto flags = function_declaration_node->flags;
 
             if(function_declaration_node->body()) {
+                TimeTraceScope trace_scope("Codegen function", function_name);
                 // ExternalLinkage: Externally visible function.
                 // InternalLinkage: Rename collisions when linking(static functions)
                 // PrivateLinkage:  Like Internal, but omit from symbol table.
@@ -338,6 +341,8 @@ llvm::Value* Module::codegen(const AST::Node* node) {
                     dump(function);
                     throw Exception(fmt::format("\n[LLVMCodegen] Error verifying function '{}'.\n", function_name));
                 }
+                if(TemplateStats::instance().is_enabled())
+                    TemplateStats::instance().record_ir_instructions(*function_declaration_node, function->getInstructionCount());
                 return function;
             } else {
                 assert(((flags & AST::FunctionDeclaration::Flag::Extern) || (flags & AST::FunctionDeclaration::Flag::Imported)) &&
@@ -353,12 +358,12 @@ llvm::Value* Module::codegen(const AST::Node* node) {
             if((function_call_node->flags & AST::FunctionDeclaration::Flag::BuiltIn) && _builtins.contains(mangled_function_name))
                 return _builtins.at(mangled_function_name)(node);
             if(!function)
-                throw Exception(fmt::format("[LLVMCodegen] Call to undeclared function '{}' (line {}).\n", mangled_function_name, function_call_node->token.line));
+                throw Exception(fmt::format("[LLVMCodegen] Call to undeclared function '{}' (line {}).\n", mangled_function_name, line_of(function_call_node->token)));
             // TODO: Handle default values.
             // TODO: Handle vargs functions (variable number of parameters, like printf :^) )
             auto function_flags = function_call_node->flags;
             if(!(function_flags & AST::FunctionDeclaration::Flag::Variadic) && function->arg_size() != function_call_node->arguments().size()) {
-                error("[LLVMCodegen] Unexpected number of parameters in function call '{}' (line {}): Expected {}, got {}.\n", mangled_function_name, node->token.line,
+                error("[LLVMCodegen] Unexpected number of parameters in function call '{}' (line {}): Expected {}, got {}.\n", mangled_function_name, line_of(node->token),
                       function->arg_size(), function_call_node->arguments().size());
                 print("Argument from function call (AST):\n");
                 for(auto i = 0; i < function_call_node->arguments().size(); ++i)
@@ -372,7 +377,7 @@ llvm::Value* Module::codegen(const AST::Node* node) {
                 }
 #endif
                 throw Exception(fmt::format("[LLVMCodegen] Unexpected number of parameters in function call '{}' (line {}): Expected {}, got {}.\n", mangled_function_name,
-                                            node->token.line, function->arg_size(), function_call_node->arguments().size()));
+                                            line_of(node->token), function->arg_size(), function_call_node->arguments().size()));
             }
             std::vector<llvm::Value*> parameters;
             for(auto arg_node : function_call_node->arguments()) {
@@ -407,7 +412,7 @@ llvm::Value* Module::codegen(const AST::Node* node) {
                 parent_function = insert_block->getParent();
             ret = create_entry_block_alloca(parent_function, type, std::string{node->token.value});
             if(!set(node->token.value, ret))
-                throw Exception(fmt::format("[LLVMCodegen] Variable '{}' already declared (line {}).\n", node->token.value, node->token.line));
+                throw Exception(fmt::format("[LLVMCodegen] Variable '{}' already declared (line {}).\n", node->token.value, line_of(node->token)));
 
             // Codegen assignment of default value.
             if(!node->children.empty()) {
@@ -486,9 +491,10 @@ llvm::Value* Module::codegen(const AST::Node* node) {
                 default: {
                     assert(is_primitive(node->children[0]->type_id));
                     auto primitive_type = static_cast<PrimitiveType>(node->children[0]->type_id);
-                    if(unary_ops[node->token.type].find(primitive_type) == unary_ops[node->token.type].end())
+                    auto ops = unary_ops.find(node->token.type);
+                    if(ops == unary_ops.end() || !ops->second.contains(primitive_type))
                         throw Exception(fmt::format("[LLVMCodegen] Unsupported type {} for unary operator {}.\n", type_id_to_string(primitive_type), node->token.type));
-                    return unary_ops[node->token.type][primitive_type](_llvm_ir_builder, val);
+                    return ops->second.at(primitive_type)(_llvm_ir_builder, val);
                 }
             }
         }
@@ -526,10 +532,11 @@ llvm::Value* Module::codegen(const AST::Node* node) {
                     // assert(node->children[0]->type_id == node->children[1]->type_id);
                     assert(is_primitive(node->children[0]->type_id));
                     auto primitive_type = static_cast<PrimitiveType>(node->children[0]->type_id);
-                    if(binary_ops[node->token.type].find(primitive_type) == binary_ops[node->token.type].end())
+                    auto ops = binary_ops.find(node->token.type);
+                    if(ops == binary_ops.end() || !ops->second.contains(primitive_type))
                         throw Exception(fmt::format("[LLVMCodegen] Unsupported types {} and {} for binary operator {}.\n", type_id_to_string(node->children[0]->type_id),
                                                     type_id_to_string(node->children[1]->type_id), node->token.type));
-                    return binary_ops[node->token.type][primitive_type](_llvm_ir_builder, lhs, rhs);
+                    return ops->second.at(primitive_type)(_llvm_ir_builder, lhs, rhs);
                 }
                 case Token::Type::And: {
                     return _llvm_ir_builder.CreateAnd(lhs, rhs, "and");
@@ -730,11 +737,9 @@ llvm::Type* Module::get_llvm_type(TypeID type_id) const {
 }
 
 llvm::Value* Module::builtin_sizeof(const AST::Node* node) {
-    static llvm::DataLayout data_layout("");
-
     auto function_call = dynamic_cast<const AST::FunctionCall*>(node);
     auto type = get_llvm_type(function_call->arguments()[0]->type_id);
-    return llvm::ConstantInt::get(llvm::IntegerType::getInt64Ty(*_llvm_context), data_layout.getTypeAllocSize(type));
+    return llvm::ConstantInt::get(llvm::IntegerType::getInt64Ty(*_llvm_context), _data_layout.getTypeAllocSize(type));
 }
 
 llvm::Value* Module::intrinsic_memcpy(const AST::Node* node) {
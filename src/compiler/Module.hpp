@@ -1,5 +1,6 @@
 #pragma once
 
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Verifier.h>
@@ -7,6 +8,7 @@
 #include <het_unordered_map.hpp>
 
 #include <AST.hpp>
+#include <Source.hpp>
 
 class Module {
   public:
@@ -123,6 +125,7 @@ class Module {
     std::unique_ptr<llvm::Module>                                                  _llvm_module;
     llvm::IRBuilder<>                                                              _llvm_ir_builder;
     std::unordered_map<std::string, std::function<llvm::Value*(const AST::Node*)>> _builtins;
+    llvm::DataLayout                                                               _data_layout{""}; // Caches struct layouts, must not be shared between threads.
 
     bool _generated_return = false; // Tracks if the last node generated a return statement (FIXME: Remove?)
 
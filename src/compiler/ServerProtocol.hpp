@@ -0,0 +1,219 @@
+#pragma once
+
+// Protocol between the compile server (compiler --server) and its client (compiler-client), over a local Unix domain socket.
+// Request:  A header carrying the standard input, output and error of the client (SCM_RIGHTS), followed by its working directory
+//           and its arguments as NUL terminated strings. The server writes directly to the client's output.
+// Response: The exit code of the compilation, as an int32.
+
+#ifndef WIN32
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace server_protocol {
+
+constexpr uint32_t magic = 0x4C414E47; // "LANG"
+constexpr uint32_t version = 1;
+constexpr uint32_t max_request_size = 1024 * 1024;
+
+struct Header {
+    uint32_t magic = server_protocol::magic;
+    uint32_t version = server_protocol::version;
+    uint32_t size = 0; // Size of the payload following the header.
+};
+
+struct Request {
+    std::array<int, 3>       fds{-1, -1, -1}; // stdin, stdout, stderr of the client.
+    std::string              working_directory;
+    std::vector<std::string> arguments;
+};
+
+// Per-user directory of the socket when there is no runtime directory, created by the server (see make_private_directory).
+inline std::filesystem::path get_private_socket_directory() {
+    return std::filesystem::temp_directory_path() / ("lang-compiler-" + std::to_string(getuid()));
+}
+
+// $LANG_SERVER_SOCKET, or a socket in the user's runtime directory ($XDG_RUNTIME_DIR), or in a private directory of the temporary directory.
+inline std::filesystem::path get_socket_path() {
+    if(const auto env = std::getenv("LANG_SERVER_SOCKET"); env && *env)
+        return env;
+    if(const auto env = std::getenv("XDG_RUNTIME_DIR"); env && *env)
+        return std::filesystem::path(env) / "lang-compiler.sock";
+    return get_private_socket_directory() / "server.sock";
+}
+
+// Creates a directory accessible only to the user.
+// Returns false if it can't be created, or if it exists but could be accessed by someone else (created by another user...).
+inline bool make_private_directory(const std::filesystem::path& path) {
+    if(mkdir(path.c_str(), 0700) != 0 && errno != EEXIST)
+        return false;
+    struct stat status;
+    return lstat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode) && status.st_uid == getuid() && (status.st_mode & 077) == 0;
+}
+
+// User id of the process on the other end of a connection, nullopt if it can't be determined.
+inline std::optional<uid_t> get_peer_uid(int socket) {
+#ifdef __linux__
+    ucred     credentials;
+    socklen_t size = sizeof(credentials);
+    if(getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0)
+        return std::nullopt;
+    return credentials.uid;
+#else
+    uid_t uid;
+    gid_t gid;
+    if(getpeereid(socket, &uid, &gid) != 0)
+        return std::nullopt;
+    return uid;
+#endif
+}
+
+// Returns false if the path doesn't fit in a socket address.
+inline bool make_address(const std::filesystem::path& path, sockaddr_un& address) {
+    const auto& str = path.native();
+    if(str.size() >= sizeof(address.sun_path))
+        return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, str.c_str(), str.size() + 1);
+    return true;
+}
+
+// Returns true on success
+inline bool write_all(int fd, const void* data, size_t size) {
+    auto ptr = static_cast<const char*>(data);
+    while(size > 0) {
+        const auto written = ::write(fd, ptr, size);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        ptr += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Returns true on success
+inline bool read_all(int fd, void* data, size_t size) {
+    auto ptr = static_cast<char*>(data);
+    while(size > 0) {
+        const auto count = ::read(fd, ptr, size);
+        if(count < 0 && errno == EINTR)
+            continue;
+        if(count <= 0)
+            return false;
+        ptr += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// Returns true on success
+inline bool send_request(int socket, const Request& request) {
+    std::string payload = request.working_directory;
+    payload += '\0';
+    for(const auto& argument : request.arguments) {
+        payload += argument;
+        payload += '\0';
+    }
+    if(payload.size() > max_request_size)
+        return false;
+    Header header;
+    header.size = static_cast<uint32_t>(payload.size());
+
+    iovec   iov{&header, sizeof(header)};
+    char    control[CMSG_SPACE(sizeof(request.fds))] = {};
+    msghdr  message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(request.fds));
+    std::memcpy(CMSG_DATA(cmsg), request.fds.data(), sizeof(request.fds));
+    ssize_t sent;
+    do
+        sent = sendmsg(socket, &message, 0);
+    while(sent < 0 && errno == EINTR);
+    if(sent != sizeof(header))
+        return false;
+    return write_all(socket, payload.data(), payload.size());
+}
+
+inline std::optional<Request> receive_request(int socket) {
+    Request request;
+    Header  header;
+    iovec   iov{&header, sizeof(header)};
+    char    control[CMSG_SPACE(sizeof(request.fds))] = {};
+    msghdr  message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t received;
+    do
+        received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    while(received < 0 && errno == EINTR);
+
+    const auto cmsg = CMSG_FIRSTHDR(&message);
+    if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(request.fds)))
+        std::memcpy(request.fds.data(), CMSG_DATA(cmsg), sizeof(request.fds));
+    const auto close_fds = [&] {
+        for(auto fd : request.fds)
+            if(fd >= 0)
+                ::close(fd);
+    };
+    // The rest of the header may arrive separately, the file descriptors are only attached to the first byte.
+    if(received <= 0 || (static_cast<size_t>(received) < sizeof(header) && !read_all(socket, reinterpret_cast<char*>(&header) + received, sizeof(header) - received)) ||
+       header.magic != magic || header.version != version || header.size > max_request_size || request.fds[0] < 0) {
+        close_fds();
+        return std::nullopt;
+    }
+
+    std::string payload(header.size, '\0');
+    if(!read_all(socket, payload.data(), payload.size()) || payload.empty() || payload.back() != '\0') {
+        close_fds();
+        return std::nullopt;
+    }
+    size_t begin = 0;
+    while(begin < payload.size()) {
+        const auto end = payload.find('\0', begin);
+        if(begin == 0)
+            request.working_directory = payload.substr(0, end);
+        else
+            request.arguments.push_back(payload.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return request;
+}
+
+// Returns true on success
+inline bool send_exit_code(int socket, int32_t code) {
+    return write_all(socket, &code, sizeof(code));
+}
+
+inline std::optional<int32_t> receive_exit_code(int socket) {
+    int32_t code = 0;
+    if(!read_all(socket, &code, sizeof(code)))
+        return std::nullopt;
+    return code;
+}
+
+} // namespace server_protocol
+
+#endif
@@ -8,6 +8,8 @@
 #include <vector>
 
 #include <FlyString.hpp>
+#include <het_unordered_map.hpp>
+#include <MemoryStats.hpp>
 #include <PrimitiveType.hpp>
 #include <Tokenizer.hpp>
 
@@ -82,6 +84,16 @@ class AST {
                 delete pNode;
         }
 
+        // Accounted in MemoryStats. The sized delete receives the size of the most derived type.
+        static void* operator new(size_t size) {
+            memory_stats::ast_nodes.allocate(static_cast<int64_t>(size));
+            return ::operator new(size);
+        }
+        static void operator delete(void* ptr, size_t size) {
+            memory_stats::ast_nodes.deallocate(static_cast<int64_t>(size));
+            ::operator delete(ptr);
+        }
+
         Type               type = Type::Undefined;
         SubType            subtype = SubType::Undefined;
         Node*              parent = nullptr;
@@ -350,7 +362,7 @@ class AST {
         explicit Literal(Token t) : Node(Type::ConstantValue, t) {}
         T value = T{};
 
-        [[nodiscard]] virtual Literal<typename T>* clone() const override {
+        [[nodiscard]] virtual Literal<T>* clone() const override {
             auto n = new Literal<T>();
             clone_impl(n);
             n->value = value;
@@ -1,18 +1,24 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
+#include <MemoryStats.hpp>
+
 static inline std::unordered_map<std::string, std::unique_ptr<std::string>> _fly_strings;
+static inline std::mutex                                                    _fly_strings_mutex;
 
 // FIXME: Global interning? (Fly strings)
 inline std::string* internalize_string(const std::string& str) {
-    auto it = _fly_strings.find(str);
+    std::lock_guard lock(_fly_strings_mutex);
+    auto            it = _fly_strings.find(str);
     if(it != _fly_strings.end()) {
         return it->second.get();
     }
     auto p = new std::string(str);
     _fly_strings.emplace(str, p);
+    memory_stats::fly_strings.allocate(static_cast<int64_t>(2 * (sizeof(std::string) + str.capacity())));
     return p;
 }
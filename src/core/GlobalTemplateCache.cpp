@@ -1,13 +1,23 @@
 #include "GlobalTemplateCache.hpp"
 
 
-const AST::FunctionDeclaration* GlobalTemplateCache::get_function(const std::string& name) {
-    if(_functions.contains(name))
-        return _functions.at(name).get();
+std::string GlobalTemplateCache::function_key(const AST::FunctionDeclaration& node) {
+    std::string key(node.token.value);
+    for(const auto& arg : node.arguments())
+        key += fmt::format(",{}", arg->type_id);
+    return key;
+}
+
+const AST::FunctionDeclaration* GlobalTemplateCache::get_function(const AST::FunctionDeclaration& declaration) {
+    const auto      key = function_key(declaration);
+    std::lock_guard lock(_mutex);
+    if(_functions.contains(key))
+        return _functions.at(key).get();
     return nullptr;
 }
 
 const AST::TypeDeclaration* GlobalTemplateCache::get_type(const std::string& name) {
+    std::lock_guard lock(_mutex);
     if(_types.contains(name))
         return _types.at(name).get();
     return nullptr;
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <AST.hpp>
 
@@ -15,15 +16,19 @@ class GlobalTemplateCache {
         return gtc;
     }
 
-    const AST::FunctionDeclaration* get_function(const std::string& name);
+    // Returns the templated function (with its body) matching the signature of the (possibly imported, bodyless) declaration.
+    const AST::FunctionDeclaration* get_function(const AST::FunctionDeclaration& declaration);
     const AST::TypeDeclaration* get_type(const std::string& name);
 
-    inline void register_function(const AST::FunctionDeclaration& node) { 
-        if(_functions.contains(std::string(node.token.value)))
+    inline void register_function(const AST::FunctionDeclaration& node) {
+        std::lock_guard lock(_mutex);
+        auto key = function_key(node);
+        if(_functions.contains(key))
             warn("[GlobalTemplateCache::register_function] Templated function '{}' already registered.\n", node.token.value);
-        _functions.emplace(std::string(node.token.value), node.clone()); 
+        _functions.emplace(std::move(key), node.clone());
     }
     inline void register_type(const AST::TypeDeclaration& node) {
+        std::lock_guard lock(_mutex);
         if(_types.contains(std::string(node.token.value)))
             warn("[GlobalTemplateCache::register_type] Templated type '{}' already registered.\n", node.token.value);
         _types.emplace(std::string(node.token.value), node.clone());
@@ -32,6 +37,13 @@ class GlobalTemplateCache {
   private:
     GlobalTemplateCache() =default;
 
+    // Templated methods share their names (constructor, destructor...) across types: Functions are identified by their name and argument types,
+    // otherwise the first registered one would shadow the others depending on the order in which modules are processed.
+    static std::string function_key(const AST::FunctionDeclaration& node);
+
+    // Modules can be parsed concurrently. Registered nodes are never removed nor replaced, so pointers returned by the getters stay valid.
+    std::mutex _mutex;
+
     std::unordered_map<std::string, std::unique_ptr<const AST::FunctionDeclaration>> _functions;
     std::unordered_map<std::string, std::unique_ptr<const AST::TypeDeclaration>> _types;
 
@@ -7,67 +7,107 @@
 #include <GlobalTemplateCache.hpp>
 
 const Type* GlobalTypeRegistry::get_type(TypeID id) const {
+    std::shared_lock lock(_mutex);
+    return get_type_impl(id);
+}
+
+const Type* GlobalTypeRegistry::get_type_impl(TypeID id) const {
     assert(id != InvalidTypeID);
     return _types[id].get();
 }
 
 const Type* GlobalTypeRegistry::get_type(const std::string& name) const {
-    auto it = _types_by_designation.find(name);
+    std::shared_lock lock(_mutex);
+    auto             it = _types_by_designation.find(name);
     if(it == _types_by_designation.end())
         throw Exception(fmt::format("[GlobalTypeRegistry::get_type] Unknown type '{}'.\n", name));
-    return get_type(it->second);
+    return get_type_impl(it->second);
 }
 
 TypeID GlobalTypeRegistry::get_type_id(const std::string& name) const {
-    auto it = _types_by_designation.find(name);
+    std::shared_lock lock(_mutex);
+    auto             it = _types_by_designation.find(name);
     if(it == _types_by_designation.end())
         throw Exception(fmt::format("[GlobalTypeRegistry::get_type] Unknown type '{}'.\n", name));
     return it->second;
 }
 
 const Type* GlobalTypeRegistry::get_or_register_type(const std::string& name) {
-    if(_types_by_designation.contains(name))
-        return get_type(name);
+    {
+        std::shared_lock lock(_mutex);
+        if(auto it = _types_by_designation.find(name); it != _types_by_designation.end())
+            return get_type_impl(it->second);
+    }
+    std::unique_lock lock(_mutex);
+    return get_or_register_type_impl(name);
+}
+
+const Type* GlobalTypeRegistry::get_or_register_type_impl(const std::string& name) {
+    if(auto it = _types_by_designation.find(name); it != _types_by_designation.end())
+        return get_type_impl(it->second);
     // Try to register unknown pointer to existing type.
     if(name.ends_with("*")) {
-        const auto& base_type = get_or_register_type(name.substr(0, name.size() - 1));
-        return get_type(get_pointer_to(base_type->type_id));
+        const auto& base_type = get_or_register_type_impl(name.substr(0, name.size() - 1));
+        return get_type_impl(get_pointer_to_impl(base_type->type_id));
     }
     throw Exception(fmt::format("[GlobalTypeRegistry::get_or_register_type] Unknown type {}.", name));
 }
 
 TypeID GlobalTypeRegistry::get_pointer_to(TypeID id) {
+    {
+        std::shared_lock lock(_mutex);
+        if(auto it = _pointers_to.find(id); it != _pointers_to.end())
+            return it->second;
+    }
+    std::unique_lock lock(_mutex);
+    return get_pointer_to_impl(id);
+}
+
+TypeID GlobalTypeRegistry::get_pointer_to_impl(TypeID id) {
     if(_pointers_to.contains(id))
         return _pointers_to.at(id);
     auto nid = next_id();
-    add_type(new PointerType(get_type(id)->designation + "*", nid, id));
+    add_type(new PointerType(get_type_impl(id)->designation + "*", nid, id));
     return nid;
 }
 
 TypeID GlobalTypeRegistry::get_array_of(TypeID id, uint32_t capacity) {
+    {
+        std::shared_lock lock(_mutex);
+        if(auto it = _arrays_of.find({id, capacity}); it != _arrays_of.end())
+            return it->second;
+    }
+    std::unique_lock lock(_mutex);
     if(_arrays_of.contains({id, capacity}))
         return _arrays_of.at({id, capacity});
     auto nid = next_id();
-    add_type(new ArrayType(get_type(id)->designation + "[" + std::to_string(capacity) + "]", nid, id, capacity));
+    add_type(new ArrayType(get_type_impl(id)->designation + "[" + std::to_string(capacity) + "]", nid, id, capacity));
     return nid;
 }
 
 TypeID GlobalTypeRegistry::get_specialized_type(TypeID id, const std::vector<TypeID>& parameters) {
     assert(!parameters.empty());
 
+    {
+        std::shared_lock lock(_mutex);
+        if(auto it = _specialized_types.find({id, parameters}); it != _specialized_types.end())
+            return it->second;
+    }
+    std::unique_lock lock(_mutex);
     if(_specialized_types.contains({id, parameters}))
         return _specialized_types.at({id, parameters});
     auto nid = next_id();
 
-    std::string type_parameters_str = get_type(parameters[0])->designation;
+    std::string type_parameters_str = get_type_impl(parameters[0])->designation;
     for(auto idx = 1; idx < parameters.size(); ++idx)
-        type_parameters_str += ", " + get_type(parameters[idx])->designation;
+        type_parameters_str += ", " + get_type_impl(parameters[idx])->designation;
 
-    add_type(new TemplatedType(get_type(id)->designation + "<" + type_parameters_str + ">", nid, id, parameters));
+    add_type(new TemplatedType(get_type_impl(id)->designation + "<" + type_parameters_str + ">", nid, id, parameters));
     return nid;
 }
 
 TypeID GlobalTypeRegistry::register_type(AST::TypeDeclaration& type_node) {
+    std::unique_lock lock(_mutex);
     if(type_node.type_id != InvalidTypeID) {
         warn("[GlobalTypeRegistry] Note: Type '{}' is already registered (type_id already set).\n", type_node.token.value);
         return type_node.type_id;
@@ -99,6 +139,7 @@ TypeID GlobalTypeRegistry::register_type(AST::TypeDeclaration& type_node) {
         ++index;
     }
     update_caches(tr);
+    lock.unlock(); // Cloning the node may query the registry.
 
     if(tr->is_templated())
         GlobalTemplateCache::instance().register_type(type_node);
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <shared_mutex>
 #include <tuple>
 #include <unordered_map>
 
 #include <AST.hpp>
+#include <MemoryStats.hpp>
 #include <ValueType.hpp>
 
 // Really simple Hash for std::vector<TypeID>, to use in cache
@@ -35,7 +37,10 @@ class GlobalTypeRegistry {
     TypeID get_pointer_to(TypeID id);
     TypeID get_array_of(TypeID id, uint32_t capacity);
     TypeID get_specialized_type(TypeID id, const std::vector<TypeID>& parameters);
-    bool   specialized_type_exists(TypeID id, const std::vector<TypeID>& parameters) { return _specialized_types.contains({id, parameters}); }
+    bool   specialized_type_exists(TypeID id, const std::vector<TypeID>& parameters) {
+        std::shared_lock lock(_mutex);
+        return _specialized_types.contains({id, parameters});
+    }
 
     TypeID register_type(AST::TypeDeclaration& type_node);
 
@@ -45,6 +50,10 @@ class GlobalTypeRegistry {
     }
 
   private:
+    // Shared by all modules, which may be compiled concurrently: Lookups take a shared lock, registrations an exclusive one.
+    // The *_impl functions expect the caller to already hold the appropriate lock.
+    mutable std::shared_mutex _mutex;
+
     std::vector<std::unique_ptr<Type>> _types;
     // Cache Lookup
     std::unordered_map<std::string, TypeID>                                   _types_by_designation;
@@ -67,6 +76,8 @@ class GlobalTypeRegistry {
     }
 
     void add_type(Type* t) {
+        // Approximation: The type, its designation and its entry in the designation cache.
+        memory_stats::type_registry.allocate(static_cast<int64_t>(sizeof(*t) + sizeof(std::unique_ptr<Type>) + 2 * (sizeof(std::string) + t->designation.capacity())));
         if(t->type_id < next_id())
             _types.emplace(_types.begin() + t->type_id, t);
         else {
@@ -79,6 +90,10 @@ class GlobalTypeRegistry {
 
     TypeID next_id() const { return _types.size(); }
 
+    const Type* get_type_impl(TypeID id) const;
+    const Type* get_or_register_type_impl(const std::string& name);
+    TypeID      get_pointer_to_impl(TypeID id);
+
     GlobalTypeRegistry() {
         _types.reserve(2 * PrimitiveType::Count);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <string_view>
 
 #include <fmt/color.h>
@@ -17,39 +18,50 @@ inline void print_link(const std::string_view& url, const std::string_view& text
     fmt::print(fmt::runtime(link(url, text)));
 }
 
+// When set, everything logged by the current thread is appended to this buffer instead of being written to stdout.
+// Used by parallel builds to keep the diagnostics of each file together and print them in a deterministic order.
+inline thread_local std::string* log_buffer = nullptr;
+
+inline void write_log(const std::string_view& str) {
+    if(log_buffer)
+        log_buffer->append(str);
+    else
+        fmt::print("{}", str);
+}
+
 template<typename... Args>
 inline void error(Args&&... args) {
-    fmt::print(fg(fmt::color::red), std::forward<Args>(args)...);
+    write_log(fmt::format(fg(fmt::color::red), std::forward<Args>(args)...));
 }
 
 template<typename... Args>
 inline void info(Args&&... args) {
-    fmt::print(fg(fmt::color::light_blue), std::forward<Args>(args)...);
+    write_log(fmt::format(fg(fmt::color::light_blue), std::forward<Args>(args)...));
 }
 
 template<typename... Args>
 inline void warn(Args&&... args) {
-    fmt::print(fg(fmt::color::yellow), std::forward<Args>(args)...);
+    write_log(fmt::format(fg(fmt::color::yellow), std::forward<Args>(args)...));
 }
 
 template<typename... Args>
 inline void success(Args&&... args) {
-    fmt::print(fg(fmt::color::green), std::forward<Args>(args)...);
+    write_log(fmt::format(fg(fmt::color::green), std::forward<Args>(args)...));
 }
 
 template<typename... Args>
 inline void print_subtle(Args&&... args) {
-    fmt::print(fg(fmt::color::gray), std::forward<Args>(args)...);
+    write_log(fmt::format(fg(fmt::color::gray), std::forward<Args>(args)...));
 }
 
 template<typename... Args>
 inline void print(Args&&... args) {
-    fmt::print(std::forward<Args>(args)...);
+    write_log(fmt::format(std::forward<Args>(args)...));
 }
 
 template<typename Format, typename... Args>
 inline void print(Format&& format, Args&&... args) {
-    fmt::print(fmt::runtime(format), std::forward<Args>(args)...); // TODO: Find a way to get rid of this fmt::runtime.
+    write_log(fmt::format(fmt::runtime(format), std::forward<Args>(args)...)); // TODO: Find a way to get rid of this fmt::runtime.
 }
 
 struct Indenter {
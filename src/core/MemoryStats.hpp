@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Bytes held by the main data structures of the compiler, reported by --mem-stats.
+// Counters are updated by the allocation paths of these structures (relaxed atomics, always on).
+namespace memory_stats {
+
+struct Counter {
+    std::atomic<int64_t> bytes = 0;
+    std::atomic<int64_t> peak = 0;
+    std::atomic<int64_t> count = 0;
+
+    void allocate(int64_t size) {
+        const auto current = bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        count.fetch_add(1, std::memory_order_relaxed);
+        auto previous_peak = peak.load(std::memory_order_relaxed);
+        while(current > previous_peak && !peak.compare_exchange_weak(previous_peak, current, std::memory_order_relaxed))
+            ;
+    }
+    void deallocate(int64_t size) {
+        bytes.fetch_sub(size, std::memory_order_relaxed);
+        count.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+// Accounts an allocation for the lifetime of the scope.
+class Allocation {
+  public:
+    Allocation(Counter& counter, int64_t size) : _counter(counter), _size(size) { _counter.allocate(_size); }
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+    ~Allocation() { _counter.deallocate(_size); }
+
+  private:
+    Counter& _counter;
+    int64_t  _size;
+};
+
+inline Counter ast_nodes;     // AST::Node and derived structures, excluding their children vectors.
+inline Counter tokens;        // Token buffers of the files being parsed.
+inline Counter fly_strings;   // Interned strings (both the key and the stored copy).
+inline Counter type_registry; // Types of the GlobalTypeRegistry and their cache entries.
+inline Counter llvm_modules;  // LLVM modules being generated, counting their instructions instead of bytes.
+
+} // namespace memory_stats
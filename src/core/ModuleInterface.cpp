@@ -1,33 +1,92 @@
 #include <ModuleInterface.hpp>
 
+#include <algorithm>
+#include <memory>
+#include <shared_mutex>
+#include <sstream>
+#include <unordered_map>
+
 #include <Parser.hpp>
+#include <TemporaryFile.hpp>
+
+// Interfaces are imported by each of their dependents: Keep their contents loaded, the SourceManager only reads them again once modified.
+// Long running processes (watch mode, compile server) only pay a stat for each import of an unmodified interface.
+static std::shared_mutex                                                             interface_files_mutex;
+static std::unordered_map<std::filesystem::path, std::shared_ptr<const SourceFile>> interface_files;
+
+std::shared_ptr<const SourceFile> read_interface_file(const std::filesystem::path& path) {
+    const auto absolute_path = std::filesystem::absolute(path).lexically_normal();
+    // Not mapped: The file will be replaced by the next compilation of its module.
+    auto contents = SourceManager::instance().load(absolute_path, false);
+    if(!contents)
+        return nullptr;
+    {
+        std::shared_lock lock(interface_files_mutex);
+        if(auto it = interface_files.find(absolute_path); it != interface_files.end() && it->second == contents)
+            return contents;
+    }
+    std::lock_guard lock(interface_files_mutex);
+    interface_files[absolute_path] = contents;
+    return contents;
+}
+
+static std::shared_mutex                                                     interface_paths_mutex;
+static std::unordered_map<std::filesystem::path, std::filesystem::path> interface_paths;
+
+void set_interface_path(const std::filesystem::path& module, const std::filesystem::path& interface_path) {
+    std::lock_guard lock(interface_paths_mutex);
+    interface_paths[module] = interface_path;
+}
+
+std::filesystem::path get_interface_path(const std::filesystem::path& interface_folder, const std::filesystem::path& module) {
+    {
+        std::shared_lock lock(interface_paths_mutex);
+        if(const auto it = interface_paths.find(module); it != interface_paths.end())
+            return it->second;
+    }
+    auto r = interface_folder;
+    r += ModuleInterface::get_cache_filename(module).replace_extension(".int");
+    return r;
+}
 
 // Returns a span containing the newly imported nodes
 std::tuple<bool, std::span<AST::TypeDeclaration*>, std::span<AST::FunctionDeclaration*>> ModuleInterface::import_module(const std::filesystem::path& path) {
-    std::ifstream module_file(path);
-    if(!module_file) {
+    const auto contents = read_interface_file(path);
+    if(!contents) {
         error("[ModuleInterface] Could not find interface file {}.\n", path.string());
         // TODO: Throw here, so we can actually directly address the issue? (i.e. 1/ Checking if the dependency exists, 2/ Compile it)
         return {false, std::span<AST::TypeDeclaration*>{}, std::span<AST::FunctionDeclaration*>{}};
     }
     // FIXME: File format not specified
-    std::string line;
-    while(std::getline(module_file, line)) {
+    const auto       content = contents->content();
+    size_t           position = 0;
+    std::string_view line;
+    // Next line, without its line break.
+    const auto next_line = [&] {
+        if(position >= content.size())
+            return false;
+        const auto end = std::min(content.find('\n', position), content.size());
+        line = content.substr(position, end - position);
+        position = end + 1;
+        return true;
+    };
+    while(next_line()) {
         if(line == "")
             break;
-        dependencies.push_back(line);
+        dependencies.emplace_back(line);
     }
 
     // Types
     auto type_begin = type_imports.size();
     {
-        AST    type_ast;
-        Parser type_parser;
-        while(std::getline(module_file, line)) {
+        AST                type_ast;
+        Parser             type_parser;
+        std::vector<Token> tokens; // Reused for each line.
+        while(next_line()) {
             if(line == "")
                 break;
-            Tokenizer          type_tokenizer(line);
-            std::vector<Token> tokens;
+            Tokenizer type_tokenizer(line);
+            tokens.clear();
             while(type_tokenizer.has_more()) {
                 tokens.push_back(type_tokenizer.consume());
             }
@@ -63,9 +122,9 @@ std::tuple<bool, std::span<AST::TypeDeclaration*>, std::span<AST::FunctionDeclar
     // Functions
     auto        begin = imports.size();
     std::string name_or_extern, name, type;
-    while(std::getline(module_file, line)) {
+    while(next_line()) {
         AST::FunctionDeclaration::Flag flags = AST::FunctionDeclaration::Flag::Imported;
-        std::istringstream             iss(line);
+        std::istringstream             iss{std::string(line)};
         iss >> name_or_extern;
         if(name_or_extern == "extern") {
             iss >> name >> type;
@@ -100,7 +159,9 @@ std::tuple<bool, std::span<AST::TypeDeclaration*>, std::span<AST::FunctionDeclar
 }
 
 bool ModuleInterface::save(const std::filesystem::path& path) const {
-    std::ofstream interface_file(path);
+    // Other compiler instances may be reading the previous version of this file: Write it on the side and swap it in once complete.
+    const auto    temporary_path = make_temporary_path(path);
+    std::ofstream interface_file(temporary_path);
     if(!interface_file) {
         error("[ModuleInterface] Could not open interface file {} for writing.\n", path.string());
         return false;
@@ -140,25 +201,78 @@ bool ModuleInterface::save(const std::filesystem::path& path) const {
         interface_file << std::endl;
     }
 
+    interface_file.close();
+    if(!interface_file || !commit_temporary_file(temporary_path, path)) {
+        error("[ModuleInterface] Could not write interface file {}.\n", path.string());
+        return false;
+    }
     return true;
 }
 
-std::filesystem::path resolve_dependency(const std::filesystem::path& working_directory, const std::string& dep) {
+struct ResolvedDependency {
+    std::filesystem::path path;
+    ResolutionProbes      probes;
+};
+
+static ResolvedDependency resolve_dependency_impl(const std::filesystem::path& working_directory, const std::string& dep) {
     // TODO: TEMP, define where (and how) we'll actually search for dependencies
-    auto fullpath = working_directory / (dep + ".lang");
+    ResolvedDependency resolved{(working_directory / (dep + ".lang")).lexically_normal()};
 
     // Look for a local version of a file, then in the 'global register', i.e. the standard library for now.
 
-    if(!std::filesystem::exists(fullpath)) {
+    const auto local_exists = std::filesystem::exists(resolved.path);
+    resolved.probes.emplace_back(resolved.path, local_exists);
+    if(!local_exists) {
         const auto stdlib_candidate = (stdlib_folder / (dep + ".lang")).lexically_normal();
-        if(std::filesystem::exists(stdlib_candidate)) {
-            fullpath = stdlib_candidate;
+        const auto stdlib_exists = std::filesystem::exists(stdlib_candidate);
+        resolved.probes.emplace_back(stdlib_candidate, stdlib_exists);
+        if(stdlib_exists) {
+            resolved.path = stdlib_candidate;
             // FIXME: Move this to a log level of debug once we have that.
             // print("[ModuleInterface] Note: Import '{}' resolved to stdlib file '{}'.\n", dep, stdlib_candidate.string());
         }
     }
 
-    return fullpath.lexically_normal();
+    return resolved;
+}
+
+// Each import is resolved by probing the file system: Remember the results, the same modules are imported by many files.
+static std::shared_mutex                                    resolved_dependencies_mutex;
+static std::unordered_map<std::string, ResolvedDependency> resolved_dependencies;
+
+std::filesystem::path resolve_dependency(const std::filesystem::path& working_directory, const std::string& dep, ResolutionProbes* probes) {
+    auto key = working_directory.string();
+    key += '\0';
+    key += dep;
+    {
+        std::shared_lock lock(resolved_dependencies_mutex);
+        if(auto it = resolved_dependencies.find(key); it != resolved_dependencies.end()) {
+            if(probes)
+                probes->insert(probes->end(), it->second.probes.begin(), it->second.probes.end());
+            return it->second.path;
+        }
+    }
+    auto resolved = resolve_dependency_impl(working_directory, dep);
+    if(probes)
+        probes->insert(probes->end(), resolved.probes.begin(), resolved.probes.end());
+    auto            path = resolved.path;
+    std::lock_guard lock(resolved_dependencies_mutex);
+    resolved_dependencies.emplace(std::move(key), std::move(resolved));
+    return path;
+}
+
+void invalidate_resolved_dependencies(const std::set<std::filesystem::path>& paths) {
+    std::lock_guard lock(resolved_dependencies_mutex);
+    std::erase_if(resolved_dependencies, [&](const auto& entry) {
+        // Removed, or a local module now shadows the standard library one.
+        return paths.contains(entry.second.path) ||
+               std::any_of(entry.second.probes.begin(), entry.second.probes.end(), [&](const auto& probe) { return paths.contains(probe.first); });
+    });
+}
+
+void clear_resolved_dependencies() {
+    std::lock_guard lock(resolved_dependencies_mutex);
+    resolved_dependencies.clear();
 }
 
 std::filesystem::path ModuleInterface::resolve_dependency(const std::string& dep) const {
@@ -2,6 +2,8 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <set>
 #include <span>
 #include <tuple>
 #include <vector>
@@ -9,13 +11,30 @@
 #include <FlyString.hpp>
 #include <GlobalTypeRegistry.hpp>
 #include <Logger.hpp>
+#include <Source.hpp>
 
 #include <Config.hpp>
 
 // FIXME: Correctly set this path.
 static const std::filesystem::path stdlib_folder(STDLIB_BASE_FOLDER);
 
-std::filesystem::path resolve_dependency(const std::filesystem::path& working_directory, const std::string& dep);
+// Files looked for while resolving an import, and whether they existed: The import may resolve differently once one of them is added or removed.
+using ResolutionProbes = std::vector<std::pair<std::filesystem::path, bool>>;
+
+// Results are memoized: Call invalidate_resolved_dependencies with the files that may have been added or removed.
+// If probes is set, the files looked for are appended to it.
+std::filesystem::path resolve_dependency(const std::filesystem::path& working_directory, const std::string& dep, ResolutionProbes* probes = nullptr);
+// Forgets the imports resolved to one of these paths, or which would resolve to one of them if it existed.
+void invalidate_resolved_dependencies(const std::set<std::filesystem::path>& paths);
+void clear_resolved_dependencies();
+
+// Contents of an interface file, kept in memory while the file is not modified. Returns nullptr if the file could not be read.
+// Keyed on the absolute path: The working directory may change (compile server).
+std::shared_ptr<const SourceFile> read_interface_file(const std::filesystem::path& path);
+
+// Modules are imported from their interface in the interface folder of the importer, unless it is somewhere else (precompiled standard library).
+void                  set_interface_path(const std::filesystem::path& module, const std::filesystem::path& interface_path);
+std::filesystem::path get_interface_path(const std::filesystem::path& interface_folder, const std::filesystem::path& module);
 
 class ModuleInterface {
   public:
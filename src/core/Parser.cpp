@@ -2,11 +2,14 @@
 
 #include <algorithm>
 #include <fstream>
+#include <mutex>
 
 #include <fmt/ranges.h>
 
 #include <GlobalTemplateCache.hpp>
 #include <ModuleInterface.hpp>
+#include <TemplateStats.hpp>
+#include <TimeTrace.hpp>
 
 const static std::array<std::vector<PrimitiveType>, PrimitiveType::Count> SafeAutomaticCasts = {{
     // Void,
@@ -98,6 +101,8 @@ bool is_allowed_but_unsafe_cast(TypeID to, TypeID from) {
 void Parser::declare_builtins(AST::Scope* scope_node) {
     // FIXME: We have to stash these somewhere. Ultimately, we'll just get rid of it hopefully, so this will do in the meantime.
     static std::unordered_map<std::string, std::unique_ptr<AST::FunctionDeclaration>> s_builtins;
+    static std::mutex                                                                  s_builtins_mutex; // Modules may be parsed concurrently.
+    std::lock_guard                                                                    lock(s_builtins_mutex);
 
     const auto register_builtin = [&](const std::string& name, TypeID type = PrimitiveType::Void, std::vector<std::string> args_names = {}, std::vector<TypeID> args_types = {},
                                       AST::FunctionDeclaration::Flag flags = AST::FunctionDeclaration::Flag::None) {
@@ -155,11 +160,19 @@ void Parser::declare_builtins(AST::Scope* scope_node) {
 }
 
 std::optional<AST> Parser::parse(const std::span<Token>& tokens) {
+    return parse_ast([&](AST::Node* scope) { return parse(tokens, scope); });
+}
+
+std::optional<AST> Parser::parse(TokenStream& tokens) {
+    return parse_ast([&](AST::Node* scope) { return parse(tokens, scope); });
+}
+
+std::optional<AST> Parser::parse_ast(const std::function<bool(AST::Node*)>& parse_scope) {
     std::optional<AST> ast(AST{});
     try {
         auto outer_scope = ast->get_root().add_child(new AST::Scope());
         declare_builtins(outer_scope);
-        bool r = parse(tokens, outer_scope);
+        bool r = parse_scope(outer_scope);
         if(!r) {
             error("Error while parsing!\n");
             ast.reset();
@@ -173,10 +186,18 @@ std::optional<AST> Parser::parse(const std::span<Token>& tokens) {
 
 // Append to an existing AST and return the added children
 AST::Node* Parser::parse(const std::span<Token>& tokens, AST& ast) {
+    return append_to_ast(ast, [&](AST::Node* scope) { return parse(tokens, scope); });
+}
+
+AST::Node* Parser::parse(TokenStream& tokens, AST& ast) {
+    return append_to_ast(ast, [&](AST::Node* scope) { return parse(tokens, scope); });
+}
+
+AST::Node* Parser::append_to_ast(AST& ast, const std::function<bool(AST::Node*)>& parse_scope) {
     // Adds a dummy root node to easily get rid of it on error.
     auto root = ast.get_root().add_child(new AST::Scope());
     declare_builtins(root);
-    bool r = parse(tokens, root);
+    bool r = parse_scope(root);
     if(!r) {
         error("Error while parsing!\n");
         delete ast.get_root().pop_child();
@@ -199,21 +220,28 @@ AST::Node* Parser::parse_type_from_interface(const std::span<Token>& tokens, AST
     return nullptr;
 }
 
-std::vector<std::string> Parser::parse_dependencies(const std::span<Token>& tokens) {
-    std::vector<std::string> dependencies;
-
-    auto it = tokens.begin();
-    while(it != tokens.end()) {
-        if(it->type == Token::Type::Import) {
-            ++it;
-            if(it->type != Token::Type::StringLiteral)
-                throw Exception(fmt::format("[Parser] Error listing dependencies: Expected a StringLiteral after import statement, got {}.", *it), point_error(*it));
-            dependencies.push_back(std::string(it->value));
+void Parser::parse_dependencies(const SourceFile& file, const std::function<void(const std::string&)>& on_dependency) {
+    TokenStream tokens(file);
+    // Imports usually lead the file: Past them, the rest of the file is only tokenized if it mentions 'import' again.
+    bool leading_imports = true;
+    while(const auto token = tokens.peek()) {
+        if(token->type == Token::Type::Import) {
+            tokens.consume();
+            const auto path = tokens.peek();
+            if(!path)
+                throw Exception("[Parser] Error listing dependencies: Expected a StringLiteral after import statement, got end-of-file.");
+            if(path->type != Token::Type::StringLiteral)
+                throw Exception(fmt::format("[Parser] Error listing dependencies: Expected a StringLiteral after import statement, got {}.", *path), point_error(*path));
+            on_dependency(std::string(tokens.consume().value));
+            continue;
         }
-        ++it;
+        if(leading_imports && token->type != Token::Type::Comment) {
+            if(file.content().find("import", token->offset) == std::string_view::npos)
+                return;
+            leading_imports = false;
+        }
+        tokens.consume();
     }
-
-    return dependencies;
 }
 
 TypeID Parser::resolve_operator_type(Token::Type op, TypeID lhs, TypeID rhs) {
@@ -271,6 +299,54 @@ TypeID Parser::resolve_operator_type(Token::Type op, TypeID lhs, TypeID rhs) {
 
 bool Parser::parse(const std::span<Token>& tokens, AST::Node* curr_node) {
     curr_node = curr_node->add_child(new AST::Node(AST::Node::Type::Statement));
+    if(!parse_statements(tokens, curr_node))
+        return false;
+    remove_empty_statement(curr_node);
+    return true;
+}
+
+bool Parser::parse(TokenStream& tokens, AST::Node* curr_node) {
+    curr_node = curr_node->add_child(new AST::Node(AST::Node::Type::Statement));
+    std::vector<Token>                      construct; // Reused: Ends up with the capacity of the largest construct.
+    size_t                                  accounted_capacity = 0;
+    std::optional<memory_stats::Allocation> construct_allocation;
+    while(next_construct(tokens, construct)) {
+        if(construct.capacity() != accounted_capacity) {
+            accounted_capacity = construct.capacity();
+            construct_allocation.reset();
+            construct_allocation.emplace(memory_stats::tokens, static_cast<int64_t>(accounted_capacity * sizeof(Token)));
+        }
+        if(!parse_statements(construct, curr_node))
+            return false;
+    }
+    remove_empty_statement(curr_node);
+    return true;
+}
+
+bool Parser::next_construct(TokenStream& tokens, std::vector<Token>& construct) {
+    construct.clear();
+    int64_t opened_scopes = 0;
+    int64_t opened_parentheses = 0; // for(;;)
+    while(tokens.has_more()) {
+        const auto& token = construct.emplace_back(tokens.consume());
+        switch(token.type) {
+            case Token::Type::OpenScope: ++opened_scopes; break;
+            case Token::Type::CloseScope: --opened_scopes; break;
+            case Token::Type::OpenParenthesis: ++opened_parentheses; break;
+            case Token::Type::CloseParenthesis: --opened_parentheses; break;
+            default: break;
+        }
+        if(opened_scopes <= 0 && opened_parentheses <= 0 && (token.type == Token::Type::EndStatement || token.type == Token::Type::CloseScope)) {
+            // An if statement continues with its else branch.
+            if(const auto next = tokens.peek(); next && next->type == Token::Type::Else)
+                continue;
+            return true;
+        }
+    }
+    return !construct.empty();
+}
+
+bool Parser::parse_statements(const std::span<Token>& tokens, AST::Node*& curr_node) {
     auto it = tokens.begin();
     while(it != tokens.end()) {
         const auto& token = *it;
@@ -367,12 +443,12 @@ bool Parser::parse(const std::span<Token>& tokens, AST::Node* curr_node) {
                     // we have to cache the result of the expression before calling local destructors.
                     // FIXME: This there a better way to do this than creating a dummy variable? (especially since we have to make sure the name is unique in this scope...
                     //        At least the invalid characters in a standard identifier prevents a user from creating a variable with the same name.)
-                    //   let #__return_expression_result_XX:YY = our_return_value;
-                    const auto& var_name = *internalize_string(fmt::format("#return_expression_result_{}:{}", return_node->token.line, return_node->token.column));
+                    //   let #return_expression_result_OFFSET:FILE_ID = our_return_value;
+                    const auto& var_name = *internalize_string(fmt::format("#return_expression_result_{}:{}", return_node->token.offset, return_node->token.file_id));
                     auto        var_dec = curr_node->add_child(
-                        new AST::VariableDeclaration(Token(Token::Type::Identifier, var_name, return_node->token.line, return_node->token.column), to_rvalue->type_id));
+                        new AST::VariableDeclaration(Token(Token::Type::Identifier, var_name, return_node->token.offset, return_node->token.file_id), to_rvalue->type_id));
                     var_dec->flags = AST::VariableDeclaration::Flag::Moved; // Declare it as moved immediatly.
-                    auto assignment = var_dec->add_child(new AST::BinaryOperator(Token(Token::Type::Assignment, *internalize_string("="), 0, 0)));
+                    auto assignment = var_dec->add_child(new AST::BinaryOperator(Token(Token::Type::Assignment, *internalize_string("="), 0)));
                     assignment->type_id = var_dec->type_id;
                     assignment->add_child(new AST::Variable(var_dec));
                     assignment->add_child(to_rvalue);
@@ -381,7 +457,7 @@ bool Parser::parse(const std::span<Token>& tokens, AST::Node* curr_node) {
                     insert_destructors();
 
                     curr_node->add_child(return_node);
-                    //   return #__return_expression_result_XX:YY;
+                    //   return #return_expression_result_OFFSET:FILE_ID;
                     return_node->add_child(new AST::LValueToRValue(new AST::Variable(var_dec)));
                     return_node->type_id = return_node->children[0]->type_id;
 
@@ -535,20 +611,23 @@ bool Parser::parse(const std::span<Token>& tokens, AST::Node* curr_node) {
                 break;
         }
     }
-    // Remove empty statements (at end of file)
+    return true;
+}
+
+// Remove empty statements (at end of file)
+void Parser::remove_empty_statement(AST::Node* curr_node) {
     if(curr_node->type == AST::Node::Type::Statement && curr_node->children.empty()) {
         auto tmp = curr_node;
         curr_node = curr_node->parent;
         curr_node->children.erase(std::find(curr_node->children.begin(), curr_node->children.end(), tmp));
         delete tmp;
     }
-    return true;
 }
 
 bool Parser::parse_next_scope(const std::span<Token>& tokens, std::span<Token>::iterator& it, AST::Node* curr_node) {
     check_eof(tokens, it, "scope opening");
     if(it->type != Token::Type::OpenScope) {
-        error("[Parser] Syntax error: Expected scope opening on line {}, got {}.\n", it->line, it->value);
+        error("[Parser] Syntax error: Expected scope opening on line {}, got {}.\n", line_of(*it), it->value);
         return false;
     }
     auto   begin = it + 1;
@@ -719,7 +798,7 @@ bool Parser::parse_next_expression(const std::span<Token>& tokens, std::span<Tok
 
     if(search_for_matching_bracket && (it == tokens.end() || it->type != Token::Type::CloseParenthesis)) {
         check_eof(tokens, it, "closing parenthesis ')'");
-        error("[Parser] Unmatched '(' on line {}.\n", it->line);
+        error("[Parser] Unmatched '(' on line {}.\n", line_of(*it));
         delete curr_node->pop_child();
         return false;
     }
@@ -829,7 +908,7 @@ bool Parser::parse_while(const std::span<Token>& tokens, std::span<Token>::itera
     ++it;
     check_eof(tokens, it, "open parenthesis");
     if(it->type != Token::Type::OpenParenthesis)
-        throw Exception(fmt::format("Expected '(' after while on line {}, got {}.\n", it->line, it->value), point_error(*it));
+        throw Exception(fmt::format("Expected '(' after while on line {}, got {}.\n", line_of(*it), it->value), point_error(*it));
 
     // Parse condition and add it as first child
     ++it; // Point to the beginning of the expression until ')' ('search_for_matching_bracket': true)
@@ -1063,9 +1142,9 @@ bool Parser::parse_type_declaration(const std::span<Token>& tokens, std::span<To
     if(has_at_least_one_default_value) {
         // Declare a default constructor.
         // FIXME: This could probably be way more elegant, rather then contructing the AST by hand...
-        auto this_token = Token(Token::Type::Identifier, *internalize_string("this"), type_node->token.line, type_node->token.column);
+        auto this_token = Token(Token::Type::Identifier, *internalize_string("this"), type_node->token.offset, type_node->token.file_id);
         auto function_node =
-            curr_node->add_child(new AST::FunctionDeclaration(Token(Token::Type::Identifier, *internalize_string("constructor"), type_node->token.line, type_node->token.column)));
+            curr_node->add_child(new AST::FunctionDeclaration(Token(Token::Type::Identifier, *internalize_string("constructor"), type_node->token.offset, type_node->token.file_id)));
         function_node->type_id = PrimitiveType::Void;
         auto function_scope = function_node->function_scope();
         auto this_declaration_node = function_scope->add_child(new AST::VariableDeclaration(this_token));
@@ -1086,18 +1165,20 @@ bool Parser::parse_type_declaration(const std::span<Token>& tokens, std::span<To
         for(auto idx = 0; idx < type->members.size(); ++idx) {
             if(default_values[idx] || constructors[idx]) {
                 assert((default_values[idx] != nullptr) xor (constructors[idx] != nullptr));
-                std::unique_ptr<AST::BinaryOperator> member_access(new AST::BinaryOperator(Token(Token::Type::MemberAccess, *internalize_string("."), 0, 0)));
+                std::unique_ptr<AST::BinaryOperator> member_access(new AST::BinaryOperator(Token(Token::Type::MemberAccess, *internalize_string("."), 0)));
                 auto                                 dereference = member_access->add_child(new AST::Node(AST::Node::Type::Dereference));
                 dereference->type_id = this_base_type;
                 auto variable = dereference->add_child(new AST::Variable(this_token));
                 variable->type_id = this_declaration_node->type_id;
                 auto member_identifier = member_access->add_child(
-                    new AST::MemberIdentifier(Token(Token::Type::Identifier, *internalize_string(std::string(type_node->members()[idx]->token.value)), 0, 0)));
+                    new AST::MemberIdentifier(Token(Token::Type::Identifier, *internalize_string(std::string(type_node->members()[idx]->token.value)), 0)));
                 member_identifier->index = idx;
                 member_identifier->type_id = type_node->members()[idx]->type_id;
                 resolve_operator_type(member_access.get());
                 if(default_values[idx]) {
-                    auto assignment = function_body->add_child(new AST::BinaryOperator(Token(Token::Type::Assignment, *internalize_string("="), 0, 0)));
+                    // Diagnostics point at the default value.
+                    const auto& value_token = default_values[idx]->token;
+                    auto        assignment = function_body->add_child(new AST::BinaryOperator(Token(Token::Type::Assignment, *internalize_string("="), value_token.offset, value_token.file_id)));
                     assignment->add_child(member_access.release());
                     assignment->add_child(default_values[idx]);
                     resolve_operator_type(assignment);
@@ -1327,8 +1408,10 @@ const AST::FunctionDeclaration* Parser::resolve_or_instanciate_function(const st
                 std::vector<TypeID> deduced_types = deduce_placeholder_types(arguments, candidate);
                 if(deduced_types.empty()) // Argument types cannot match.
                     continue;
+                TimeTraceScope trace_scope("Instantiate function", candidate->token.value);
+                const auto     instantiation_start = std::chrono::high_resolution_clock::now();
 
-                auto specialized = candidate->body() ? candidate->clone() : GlobalTemplateCache::instance().get_function(std::string(candidate->token.value))->clone();
+                auto specialized = candidate->body() ? candidate->clone() : GlobalTemplateCache::instance().get_function(*candidate)->clone();
 
                 auto parent = candidate->parent ? candidate->parent : get_hoisted_declarations_node(curr_node);
                 // FIXME: Should be after because specialize can create more function specialization that this function will depend on, but it also need to be in the AST to
@@ -1340,6 +1423,8 @@ const AST::FunctionDeclaration* Parser::resolve_or_instanciate_function(const st
 
                 specialize(specialized, deduced_types);
                 check_function_return_type(specialized);
+                if(TemplateStats::instance().is_enabled())
+                    TemplateStats::instance().record_function(*candidate, deduced_types, *specialized, std::chrono::high_resolution_clock::now() - instantiation_start);
 
                 // HACK: Specialize() may have added more hoisted declaration, this function should be declared after.
                 //       Remove it and re-insert it at the end:
@@ -1523,7 +1608,7 @@ bool Parser::parse_operator(const std::span<Token>& tokens, std::span<Token>::it
 
     // Should have been handled by others parsing functions.
     if(operator_type == Token::Type::CloseParenthesis)
-        throw Exception(fmt::format("[Parser::parse_operator] Unmatched ')' on line {}.\n", it->line), point_error(*it));
+        throw Exception(fmt::format("[Parser::parse_operator] Unmatched ')' on line {}.\n", line_of(*it)), point_error(*it));
 
     // Function call
     if(operator_type == Token::Type::OpenParenthesis) {
@@ -1891,7 +1976,7 @@ bool Parser::parse_variable_declaration(const std::span<Token>& tokens, std::spa
             std::vector<TypeID> span;
             span.push_back(GlobalTypeRegistry::instance().get_pointer_to(var_declaration_node->type_id));
             auto constructor = resolve_or_instanciate_function("constructor", span, var_declaration_node);
-            auto fake_token = Token(Token::Type::Identifier, *internalize_string("constructor"), var_declaration_node->token.line, var_declaration_node->token.column);
+            auto fake_token = Token(Token::Type::Identifier, *internalize_string("constructor"), var_declaration_node->token.offset, var_declaration_node->token.file_id);
             if(constructor) {
                 auto call_node = var_declaration_node->add_child(new AST::FunctionCall(fake_token));
                 // Constructor method designation
@@ -1917,10 +2002,9 @@ bool Parser::parse_import(const std::span<Token>& tokens, std::span<Token>::iter
 
     std::string module_name = std::string(it->value);
     _module_interface.dependencies.push_back(module_name);
-    auto cached_interface_file = _cache_folder;
-    cached_interface_file += ModuleInterface::get_cache_filename(_module_interface.resolve_dependency(module_name)).replace_extension(".int");
+    const auto interface_file = get_interface_path(_cache_folder, _module_interface.resolve_dependency(module_name));
 
-    auto [success, new_type_imports, new_function_imports] = _module_interface.import_module(cached_interface_file);
+    auto [success, new_type_imports, new_function_imports] = _module_interface.import_module(interface_file);
     if(!success)
         return false;
 
@@ -2014,9 +2098,9 @@ void Parser::resolve_operator_type(AST::UnaryOperator* op_node) {
     op_node->type_id = rhs;
 
     if(op_node->type_id == InvalidTypeID) {
-        error("[Parser] Couldn't resolve unary operator return type (Missing impl.) on line {}. Node:\n", op_node->token.line);
+        error("[Parser] Couldn't resolve unary operator return type (Missing impl.) on line {}. Node:\n", line_of(op_node->token));
         fmt::print("{}\n", *static_cast<AST::Node*>(op_node));
-        throw Exception(fmt::format("[Parser] Couldn't resolve unary operator return type (Missing impl.) on line {}.\n", op_node->token.line));
+        throw Exception(fmt::format("[Parser] Couldn't resolve unary operator return type (Missing impl.) on line {}.\n", line_of(op_node->token)));
     }
 }
 
@@ -2048,9 +2132,9 @@ void Parser::resolve_operator_type(AST::BinaryOperator* op_node) {
                 op_node->type_id = InvalidTypeID;
                 return;
             }
-            error("[Parser] Couldn't resolve binary operator return type (Missing impl.) on line {}. Node:\n", op_node->token.line);
+            error("[Parser] Couldn't resolve binary operator return type (Missing impl.) on line {}. Node:\n", line_of(op_node->token));
             fmt::print("{}\n", *static_cast<AST::Node*>(op_node));
-            throw Exception(fmt::format("[Parser] Couldn't resolve binary operator return type (Missing impl.) on line {}.\n", op_node->token.line));
+            throw Exception(fmt::format("[Parser] Couldn't resolve binary operator return type (Missing impl.) on line {}.\n", line_of(op_node->token)));
         }
     }
 }
@@ -2146,12 +2230,14 @@ void Parser::declare_specialized_type(TypeID specialized_type_id, const std::vec
     auto type = GlobalTypeRegistry::instance().get_type(specialized_type_id);
     assert(type->is_templated());
     if(!type->is_placeholder()) {
-        auto templated_type = dynamic_cast<const TemplatedType*>(type);
+        auto           templated_type = dynamic_cast<const TemplatedType*>(type);
+        TimeTraceScope trace_scope("Instantiate type", templated_type->designation);
+        const auto     instantiation_start = std::chrono::high_resolution_clock::now();
         auto underlying_type = GlobalTypeRegistry::instance().get_type(templated_type->template_type_id);
         assert(underlying_type->is_struct());
         auto struct_type = dynamic_cast<const StructType*>(underlying_type);
 
-        AST::TypeDeclaration* type_declaration_node = new AST::TypeDeclaration(Token(Token::Type::Identifier, templated_type->designation, 0, 0));
+        AST::TypeDeclaration* type_declaration_node = new AST::TypeDeclaration(Token(Token::Type::Identifier, templated_type->designation, 0));
         type_declaration_node->type_id = specialized_type_id;
         auto type_scope = type_declaration_node->add_child(new AST::Scope());
         // Insert specialized members in the same order as the original declaration
@@ -2160,10 +2246,13 @@ void Parser::declare_specialized_type(TypeID specialized_type_id, const std::vec
         for(const auto& [name, member] : struct_type->members)
             members[member.index] = &member;
         for(const auto& member : members) {
-            auto mem = type_scope->add_child(new AST::VariableDeclaration(Token(Token::Type::Identifier, member->name, 0, 0)));
+            auto mem = type_scope->add_child(new AST::VariableDeclaration(Token(Token::Type::Identifier, member->name, 0)));
             mem->type_id = member->type_id;
         }
         specialize(type_declaration_node, type_parameters);
+        if(TemplateStats::instance().is_enabled())
+            TemplateStats::instance().record_type(std::string(underlying_type->designation), type_parameters, *type_declaration_node,
+                                                  std::chrono::high_resolution_clock::now() - instantiation_start);
         // Declare early
         get_hoisted_declarations_node(curr_node)->add_child(type_declaration_node);
         // FIXME: Systematically exports nexly generated template specializations.
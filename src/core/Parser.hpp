@@ -3,6 +3,7 @@
 #include <cassert>
 #include <charconv>
 #include <filesystem>
+#include <functional>
 #include <optional>
 #include <span>
 
@@ -13,6 +14,7 @@
 #include <Logger.hpp>
 #include <ModuleInterface.hpp>
 #include <Source.hpp>
+#include <TokenStream.hpp>
 #include <Tokenizer.hpp>
 
 class Parser {
@@ -24,16 +26,19 @@ class Parser {
     Parser& operator=(Parser&&) = default;
     virtual ~Parser() = default;
 
-    void set_source(const std::string& src) { _source = &src; }
     void set_cache_folder(const std::filesystem::path& path) { _cache_folder = path; }
 
     std::optional<AST> parse(const std::span<Token>& tokens);
+    // Pulls the tokens one top-level construct at a time: Only the tokens of the current one are kept in memory.
+    std::optional<AST> parse(TokenStream& tokens);
     // Append to an existing AST and return the added children
     AST::Node* parse(const std::span<Token>& tokens, AST& ast);
+    AST::Node* parse(TokenStream& tokens, AST& ast);
 
     AST::Node* parse_type_from_interface(const std::span<Token>& tokens, AST& ast);
 
-    std::vector<std::string> parse_dependencies(const std::span<Token>& tokens);
+    // Calls on_dependency with the path of each import of file, as soon as it is found.
+    void parse_dependencies(const SourceFile& file, const std::function<void(const std::string&)>& on_dependency);
 
     // Returns true if the next token exists and matches the supplied type and value.
     // Doesn't advance the iterator.
@@ -47,7 +52,6 @@ class Parser {
     bool                   write_export_interface(const std::filesystem::path&) const;
 
   private:
-    const std::string*    _source = nullptr;
     std::filesystem::path _cache_folder{"./lang_cache/"};
 
     ModuleInterface _module_interface;
@@ -65,7 +69,17 @@ class Parser {
     // FIXME: I'd like to get rid of this at some point.
     void declare_builtins(AST::Scope*);
 
+    std::optional<AST> parse_ast(const std::function<bool(AST::Node*)>& parse_scope);
+    AST::Node*         append_to_ast(AST& ast, const std::function<bool(AST::Node*)>& parse_scope);
+
     bool parse(const std::span<Token>& tokens, AST::Node* curr_node);
+    bool parse(TokenStream& tokens, AST::Node* curr_node);
+    // Parses tokens as a sequence of statements, curr_node is the statement being parsed and is updated as they end.
+    bool parse_statements(const std::span<Token>& tokens, AST::Node*& curr_node);
+    void remove_empty_statement(AST::Node* curr_node);
+    // Tokens of the next top-level construct (statement, declaration, if/else chain...): The parser needs random access within a construct, but not across them.
+    // Returns false once the stream is exhausted.
+    bool next_construct(TokenStream& tokens, std::vector<Token>& construct);
 
     bool                     parse_next_scope(const std::span<Token>& tokens, std::span<Token>::iterator& it, AST::Node* curr_node);
     bool                     parse_next_expression(const std::span<Token>& tokens, std::span<Token>::iterator& it, AST::Node* curr_node, uint32_t precedence = max_precedence,
@@ -117,13 +131,6 @@ class Parser {
             ++it;
     }
 
-    template<typename... Args>
-    std::string point_error(Args&&... args) {
-        if(_source)
-            return ::point_error(*_source, args...);
-        return "[Parser] _source not defined, cannot display the line.\n";
-    }
-
     Token expect(const std::span<Token>& tokens, std::span<Token>::iterator& it, Token::Type token_type) {
         if(it == tokens.end()) {
             throw Exception(fmt::format("[Parser] Syntax error: Expected '{}', got end-of-file.", token_type));
@@ -1,20 +1,113 @@
 #include <Source.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <fstream>
 
 #include <fmt/format.h>
 
-std::string_view get_nth_line(const std::string& source, size_t n) {
-    size_t start = 0;
-    while(start < source.size() && n > 0) {
-        if(source[start] == '\n')
-            --n;
-        ++start;
+#include <CharScan.hpp>
+#include <Exception.hpp>
+
+LineTable::LineTable(std::string_view source) : _source(source) {
+    assert(source.size() <= std::numeric_limits<uint32_t>::max());
+    _line_starts.push_back(0);
+    const auto end = source.data() + source.size();
+    for(auto it = char_scan::find(source.data(), end, '\n'); it != end; it = char_scan::find(it + 1, end, '\n'))
+        _line_starts.push_back(static_cast<uint32_t>(it + 1 - source.data()));
+}
+
+LineTable::Position LineTable::position(size_t offset) const noexcept {
+    const auto next_line = std::upper_bound(_line_starts.begin(), _line_starts.end(), offset);
+    const auto line = static_cast<size_t>(next_line - _line_starts.begin()) - 1;
+    return {line, offset - _line_starts[line]};
+}
+
+std::string_view LineTable::get_line(size_t line) const noexcept {
+    if(line >= _line_starts.size())
+        return {};
+    const size_t start = _line_starts[line];
+    const size_t end = line + 1 < _line_starts.size() ? _line_starts[line + 1] - 1 : _source.size();
+    return _source.substr(start, end - start);
+}
+
+const LineTable& SourceFile::line_table() const {
+    std::call_once(_line_table_flag, [this] { _line_table.emplace(_content); });
+    return *_line_table;
+}
+
+std::shared_ptr<const SourceFile> SourceManager::load(const std::filesystem::path& path, bool allow_mapping) {
+    std::error_code ec;
+    const auto      size = std::filesystem::file_size(path, ec);
+    if(ec)
+        return nullptr;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    if(ec)
+        return nullptr;
+    {
+        std::shared_lock lock(_mutex);
+        if(const auto it = _ids.find(path); it != _ids.end() && it->second != 0)
+            if(auto file = _files[it->second - 1].file.lock(); file && file->_file_size == size && file->_file_time == time)
+                return file;
+    }
+
+    // Read outside of the lock: The ID is only assigned once the contents are available.
+    std::shared_ptr<SourceFile> file(new SourceFile(0, path.string()));
+    file->_file_size = size;
+    file->_file_time = time;
+    // On failure, the file is read instead.
+    if(allow_mapping && size >= SourceFile::map_threshold && file->_mapped.open(path))
+        file->_content = file->_mapped.view();
+    if(!file->_mapped.data()) {
+        std::ifstream input(path, std::ios::binary);
+        if(!input)
+            return nullptr;
+        file->_buffer.resize(static_cast<size_t>(size));
+        input.read(file->_buffer.data(), static_cast<std::streamsize>(file->_buffer.size()));
+        file->_buffer.resize(static_cast<size_t>(input.gcount()));
+        file->_content = file->_buffer;
     }
-    auto end = source.find('\n', start + 1);
-    if(end == source.npos)
-        end = source.size();
-    return std::string_view(source.data() + start, source.data() + end);
+
+    std::lock_guard lock(_mutex);
+    auto&           id = _ids[path];
+    if(id == 0)
+        id = next_id();
+    file->_id = id;
+    _files[id - 1] = {file, path, size, time};
+    return file;
+}
+
+std::shared_ptr<const SourceFile> SourceManager::add(std::string name, std::string content) {
+    std::shared_ptr<SourceFile> file(new SourceFile(0, std::move(name)));
+    file->_buffer = std::move(content);
+    file->_content = file->_buffer;
+    std::lock_guard lock(_mutex);
+    file->_id = next_id();
+    _files[file->_id - 1].file = file;
+    return file;
+}
+
+std::shared_ptr<const SourceFile> SourceManager::get(SourceFile::ID id) {
+    Entry entry;
+    {
+        std::shared_lock lock(_mutex);
+        if(id == 0 || id > _files.size())
+            return nullptr;
+        entry = _files[id - 1];
+    }
+    if(auto file = entry.file.lock())
+        return file;
+    if(entry.path.empty())
+        return nullptr;
+    auto file = load(entry.path);
+    return file && file->_file_size == entry.size && file->_file_time == entry.time ? file : nullptr;
+}
+
+SourceFile::ID SourceManager::next_id() {
+    if(_files.size() >= std::numeric_limits<SourceFile::ID>::max())
+        throw Exception(fmt::format("[SourceManager] Error: Too many sources, all of the {} IDs are taken.", std::numeric_limits<SourceFile::ID>::max()));
+    _files.emplace_back();
+    return static_cast<SourceFile::ID>(_files.size());
 }
 
 // [from, to[
@@ -47,13 +140,29 @@ std::string point_error_impl(const std::string_view& line, size_t at, size_t lin
     return return_value;
 }
 
-std::string point_error_impl(const std::string_view& line, const Token& token) noexcept {
-    return point_error_impl(line, token.column, token.line, token.column, token.column + token.value.size());
+std::string point_error(const LineTable& lines, const Token& token) noexcept { return point_error(lines, token.offset, token.offset, token.offset + token.value.size()); }
+
+std::string point_error(const LineTable& lines, size_t at, size_t from, size_t to) noexcept {
+    const auto position = lines.position(at);
+    const auto line_start = at - position.column;
+    // Convert the offsets to columns on the line of at.
+    const auto to_column = [&](size_t offset) {
+        if(offset == std::numeric_limits<size_t>::max())
+            return offset;
+        return offset > line_start ? offset - line_start : 0;
+    };
+    return point_error_impl(lines.get_line(position.line), position.column, position.line, to_column(from), to_column(to));
 }
 
-std::string point_error(const std::string& source, const Token& token) noexcept {
-    return point_error_impl(get_nth_line(source, token.line), token);
+std::string point_error(const Token& token) noexcept {
+    // The file may have been modified since: Only point into it if the token still fits.
+    if(const auto file = SourceManager::instance().get(token.file_id); file && token.offset + token.value.size() <= file->content().size())
+        return point_error(file->line_table(), token);
+    return "Source of the token not available, cannot display the line.\n";
 }
-std::string point_error(const std::string& source, size_t at, size_t line_number, size_t from, size_t to) noexcept {
-    return point_error_impl(get_nth_line(source, line_number), at, line_number, from, to);
+
+size_t line_of(const Token& token) noexcept {
+    if(const auto file = SourceManager::instance().get(token.file_id); file && token.offset <= file->content().size())
+        return file->line_table().line(token.offset);
+    return 0;
 }
@@ -1,10 +1,114 @@
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
+#include <MappedFile.hpp>
 #include <Token.hpp>
 
-std::string point_error(const std::string& source, const Token& token) noexcept;
-std::string point_error(const std::string& source, size_t at, size_t line, size_t from = (std::numeric_limits<size_t>::max)(),
-                        size_t to = (std::numeric_limits<size_t>::max)()) noexcept;
+// Start of each line of a source, built only when a position is needed (diagnostics): Tokens only store their offset.
+class LineTable {
+  public:
+    struct Position {
+        size_t line = 0;   // 0-based.
+        size_t column = 0; // 0-based, in bytes.
+    };
+
+    explicit LineTable(std::string_view source);
+
+    Position         position(size_t offset) const noexcept;
+    size_t           line(size_t offset) const noexcept { return position(offset).line; }
+    std::string_view get_line(size_t line) const noexcept; // Without its line break.
+
+  private:
+    std::string_view      _source;
+    std::vector<uint32_t> _line_starts;
+};
+
+// Contents of a source file, or of a buffer which isn't one (REPL input...), at a stable address for the lifetime of the object:
+// Tokens point into it, and reference it by (file_id, offset) for diagnostics. Created by the SourceManager.
+class SourceFile {
+  public:
+    using ID = uint16_t;                               // 0 is reserved for tokens without a known source.
+    static constexpr size_t map_threshold = 16 * 1024; // Smaller files are read, mapping them costs more than copying them.
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    ID                 id() const noexcept { return _id; }
+    const std::string& name() const noexcept { return _name; } // Path of the file, or name of the buffer.
+    std::string_view   content() const noexcept { return _content; }
+    bool               is_mapped() const noexcept { return _mapped.data() != nullptr; }
+
+    const LineTable& line_table() const; // Built on first use, thread-safe.
+
+  private:
+    SourceFile(ID id, std::string name) : _id(id), _name(std::move(name)) {}
+
+    ID                              _id;
+    std::string                     _name;
+    std::string                     _buffer; // Contents, when they are not mapped.
+    MappedFile                      _mapped;
+    std::string_view                _content;
+    uintmax_t                       _file_size = 0; // At the time it was read: A modified file is loaded again.
+    std::filesystem::file_time_type _file_time;
+
+    mutable std::once_flag           _line_table_flag;
+    mutable std::optional<LineTable> _line_table;
+
+    friend class SourceManager;
+};
+
+static_assert(std::is_same_v<SourceFile::ID, decltype(Token::file_id)>);
+
+// Owner of the sources: Each path gets a stable ID for the lifetime of the process, and is only read again once modified.
+// Contents are released when nobody uses them anymore (scan, parsing, codegen, diagnostics...). Thread-safe.
+class SourceManager {
+  public:
+    static SourceManager& instance() {
+        static SourceManager manager;
+        return manager;
+    }
+
+    // nullptr if the file cannot be read. Large files are mapped unless allow_mapping is false:
+    // A mapped file can't be replaced on Windows, so contents kept around indefinitely (interface files) shouldn't be mapped.
+    std::shared_ptr<const SourceFile> load(const std::filesystem::path& path, bool allow_mapping = true);
+    // A buffer, with its own ID.
+    std::shared_ptr<const SourceFile> add(std::string name, std::string content);
+    // Tokens may outlive their source (imported templates...): A released file is read again if it hasn't been modified since.
+    // nullptr if the ID is unknown, or if the contents are not available anymore.
+    std::shared_ptr<const SourceFile> get(SourceFile::ID id);
+
+  private:
+    SourceManager() = default;
+
+    SourceFile::ID next_id(); // Throws once all of the IDs are taken. Paths keep theirs when they are loaded again.
+
+    struct Entry {
+        std::weak_ptr<const SourceFile> file;
+        std::filesystem::path           path; // Empty for buffers: They can't be read again.
+        uintmax_t                       size = 0;
+        std::filesystem::file_time_type time;
+    };
+
+    std::shared_mutex                                          _mutex;
+    std::vector<Entry>                                         _files; // Indexed by ID - 1.
+    std::unordered_map<std::filesystem::path, SourceFile::ID> _ids;
+};
+
+// at, from and to are offsets in the source.
+std::string point_error(const LineTable& lines, const Token& token) noexcept;
+std::string point_error(const LineTable& lines, size_t at, size_t from = (std::numeric_limits<size_t>::max)(), size_t to = (std::numeric_limits<size_t>::max)()) noexcept;
+// Through the SourceManager, using the file the token comes from.
+std::string point_error(const Token& token) noexcept;
+size_t      line_of(const Token& token) noexcept; // 0 if the source of the token is not available.
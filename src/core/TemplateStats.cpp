@@ -0,0 +1,82 @@
+#include "TemplateStats.hpp"
+
+#include <algorithm>
+
+#include <GlobalTypeRegistry.hpp>
+
+static size_t count_nodes(const AST::Node& node) {
+    size_t count = 1;
+    for(const auto child : node.children)
+        count += count_nodes(*child);
+    return count;
+}
+
+static std::string designate(const std::vector<TypeID>& type_ids) {
+    std::string r;
+    for(const auto type_id : type_ids) {
+        if(!r.empty())
+            r += ", ";
+        r += GlobalTypeRegistry::instance().get_type(type_id)->designation;
+    }
+    return r;
+}
+
+TemplateStats::Template& TemplateStats::get(const std::string& name) {
+    auto& t = _templates[name];
+    t.name = name;
+    return t;
+}
+
+void TemplateStats::record_function(const AST::FunctionDeclaration& templated_function, const std::vector<TypeID>& type_arguments,
+                                    const AST::FunctionDeclaration& specialization, std::chrono::high_resolution_clock::duration duration) {
+    std::vector<TypeID> argument_types;
+    for(const auto& argument : templated_function.arguments())
+        argument_types.push_back(argument->type_id);
+    const auto name = fmt::format("{}({})", templated_function.token.value, designate(argument_types));
+    const auto nodes = count_nodes(specialization);
+
+    std::lock_guard lock(_mutex);
+    auto&           t = get(name);
+    ++t.instantiations;
+    t.type_arguments.insert(designate(type_arguments));
+    t.cloned_nodes += nodes;
+    t.duration += std::chrono::duration<double, std::milli>(duration).count();
+    _specializations[&specialization] = name;
+}
+
+void TemplateStats::record_type(const std::string& name, const std::vector<TypeID>& type_arguments, const AST::Node& specialization,
+                                std::chrono::high_resolution_clock::duration duration) {
+    const auto nodes = count_nodes(specialization);
+
+    std::lock_guard lock(_mutex);
+    auto&           t = get("type " + name);
+    ++t.instantiations;
+    t.type_arguments.insert(designate(type_arguments));
+    t.cloned_nodes += nodes;
+    t.duration += std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void TemplateStats::record_ir_instructions(const AST::FunctionDeclaration& function, size_t count) {
+    std::lock_guard lock(_mutex);
+    if(auto it = _specializations.find(&function); it != _specializations.end()) {
+        _templates[it->second].ir_instructions += count;
+        _specializations.erase(it);
+    }
+}
+
+std::vector<TemplateStats::Template> TemplateStats::get_sorted() const {
+    std::vector<Template> r;
+    {
+        std::lock_guard lock(_mutex);
+        for(const auto& [name, t] : _templates)
+            r.push_back(t);
+    }
+    std::sort(r.begin(), r.end(), [](const auto& lhs, const auto& rhs) { return lhs.duration > rhs.duration; });
+    return r;
+}
+
+void TemplateStats::clear() {
+    std::lock_guard lock(_mutex);
+    _templates.clear();
+    _specializations.clear();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <AST.hpp>
+
+// Cost of the template instantiations (see Parser::resolve_or_instanciate_function and Parser::declare_specialized_type):
+// Each instantiation clones and type-checks the AST of the template, in every module using it. Collected only when enabled.
+class TemplateStats {
+  public:
+    struct Template {
+        std::string           name; // Template with its parameters, e.g. "push_back(Array<__placeholder_0>*, __placeholder_0)".
+        size_t                instantiations = 0;
+        std::set<std::string> type_arguments; // Distinct sets of type arguments.
+        size_t                cloned_nodes = 0;
+        double                duration = 0; // In milliseconds.
+        size_t                ir_instructions = 0;
+    };
+
+    inline static TemplateStats& instance() {
+        static TemplateStats template_stats;
+        return template_stats;
+    }
+
+    void enable() { _enabled = true; }
+    bool is_enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    void record_function(const AST::FunctionDeclaration& templated_function, const std::vector<TypeID>& type_arguments, const AST::FunctionDeclaration& specialization,
+                         std::chrono::high_resolution_clock::duration duration);
+    void record_type(const std::string& name, const std::vector<TypeID>& type_arguments, const AST::Node& specialization, std::chrono::high_resolution_clock::duration duration);
+    // Called when the code of a function is generated, instructions of specializations are accounted to their template.
+    void record_ir_instructions(const AST::FunctionDeclaration& function, size_t count);
+
+    // Templates sorted by time spent instantiating them.
+    std::vector<Template> get_sorted() const;
+    void                  clear();
+
+  private:
+    TemplateStats() = default;
+
+    Template& get(const std::string& name);
+
+    std::atomic<bool>                                                _enabled = false;
+    mutable std::mutex                                               _mutex;
+    std::unordered_map<std::string, Template>                        _templates;
+    std::unordered_map<const AST::FunctionDeclaration*, std::string> _specializations; // Name of the template of each specialization, until its code is generated.
+};
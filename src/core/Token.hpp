@@ -1,13 +1,14 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 
 #include <fmt/color.h>
 #include <fmt/core.h>
 #include <fmt/format.h>
 
 struct Token {
-    enum class Type {
+    enum class Type : uint8_t {
         EndStatement,
         Comma,
         OpenScope,
@@ -68,14 +69,13 @@ struct Token {
 
     Token() = default;
 
-    Token(Type type, const std::string_view val, size_t line, size_t column) : type(type), value(val), line(line), column(column) {}
+    Token(Type type, const std::string_view val, uint32_t offset, uint16_t file_id = 0) : value(val), offset(offset), file_id(file_id), type(type) {}
 
-    Type             type = Type::Unknown;
+    // Ordered to fit in 24 bytes: Tokens are kept for whole files.
     std::string_view value;
-
-    // Debug Info
-    size_t line = 0;
-    size_t column = 0; // FIXME: TODO
+    uint32_t         offset = 0;  // Position in the source, line and column are resolved on demand by a LineTable (see Source.hpp).
+    uint16_t         file_id = 0; // SourceFile::ID of the source, 0 if it is not managed by the SourceManager.
+    Type             type = Type::Unknown;
 };
 
 // fmt Formaters for Token and Token::Type
@@ -91,7 +91,7 @@ struct fmt::formatter<Token> {
 
     template<typename FormatContext>
     auto format(const Token& t, FormatContext& ctx) const -> decltype(ctx.out()) {
-        return fmt::format_to(ctx.out(), fg(fmt::color::gray), "T({} {:12} {:3})", t.type, t.value, t.line);
+        return fmt::format_to(ctx.out(), fg(fmt::color::gray), "T({} {:12} {:3})", t.type, t.value, t.offset);
     }
 };
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <string_view>
+
+#include <Tokenizer.hpp>
+
+// Pulls tokens from a Tokenizer on demand, with a bounded lookahead: Memory use doesn't depend on the size of the source.
+class TokenStream {
+  public:
+    static constexpr size_t max_lookahead = 4; // Power of two.
+
+    explicit TokenStream(std::string_view source, SourceFile::ID file_id = 0) : _tokenizer(source, file_id) {}
+    explicit TokenStream(const SourceFile& file) : _tokenizer(file) {}
+
+    bool has_more() const noexcept { return _count > 0 || _tokenizer.has_more(); }
+
+    // n-th token after the current one, without consuming it. nullptr if the source ends before.
+    const Token* peek(size_t n = 0) {
+        assert(n < max_lookahead);
+        while(_count <= n && _tokenizer.has_more()) {
+            _buffer[(_first + _count) & (max_lookahead - 1)] = _tokenizer.consume();
+            ++_count;
+        }
+        return _count > n ? &_buffer[(_first + n) & (max_lookahead - 1)] : nullptr;
+    }
+
+    Token consume() {
+        if(_count == 0)
+            return _tokenizer.consume();
+        const auto token = _buffer[_first];
+        _first = (_first + 1) & (max_lookahead - 1);
+        --_count;
+        return token;
+    }
+
+  private:
+    Tokenizer                         _tokenizer;
+    std::array<Token, max_lookahead> _buffer; // Ring buffer of the tokens peeked but not consumed yet.
+    size_t                            _first = 0;
+    size_t                            _count = 0;
+};
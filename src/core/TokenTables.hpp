@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include <Token.hpp>
+
+// Keyword and operator recognition used by the Tokenizer, entirely resolved at compile time: Nothing to construct at runtime.
+namespace token_tables {
+
+struct Keyword {
+    std::string_view name;
+    Token::Type      type;
+};
+
+inline constexpr std::array<Keyword, 21> keywords{{
+    {"function", Token::Type::Function}, {"let", Token::Type::Let},          {"return", Token::Type::Return},   {"if", Token::Type::If},
+    {"else", Token::Type::Else},         {"while", Token::Type::While},      {"for", Token::Type::For},         {"bool", Token::Type::Identifier},
+    {"int", Token::Type::Identifier},    {"float", Token::Type::Identifier}, {"char", Token::Type::Identifier}, {"true", Token::Type::Boolean},
+    {"false", Token::Type::Boolean},     {"const", Token::Type::Const},      {"import", Token::Type::Import},   {"export", Token::Type::Export},
+    {"extern", Token::Type::Extern},     {"type", Token::Type::Type},        {"and", Token::Type::And},         {"or", Token::Type::Or},
+    {"sizeof", Token::Type::Sizeof},
+}};
+
+// Perfect hash of the keywords: Each one gets its own slot, identified by its length and its first, second and last characters.
+// The multipliers are searched at compile time, a keyword lookup is then one hash and one string comparison.
+class KeywordTable {
+  public:
+    static constexpr size_t size = 64; // Power of two.
+
+    consteval KeywordTable() {
+        for(_first_multiplier = 1; _first_multiplier < size; ++_first_multiplier)
+            for(_second_multiplier = 1; _second_multiplier < size; ++_second_multiplier)
+                if(try_fill())
+                    return;
+        throw "No perfect hash found for the keywords, try a larger table."; // Not a constant expression: Fails the compilation.
+    }
+
+    // Type of the keyword, nullptr if str isn't a keyword. str must not be empty.
+    constexpr const Token::Type* find(std::string_view str) const noexcept {
+        const auto& slot = _slots[hash(str)];
+        return slot.name == str ? &slot.type : nullptr;
+    }
+
+  private:
+    std::array<Keyword, size> _slots{};
+    size_t                    _first_multiplier = 1;
+    size_t                    _second_multiplier = 1;
+
+    constexpr size_t hash(std::string_view str) const noexcept {
+        const auto second = str.size() > 1 ? static_cast<uint8_t>(str[1]) : 0u;
+        return (static_cast<uint8_t>(str.front()) * _first_multiplier + second * _second_multiplier + static_cast<uint8_t>(str.back()) + str.size()) & (size - 1);
+    }
+
+    constexpr bool try_fill() {
+        _slots = {};
+        for(const auto& keyword : keywords) {
+            auto& slot = _slots[hash(keyword.name)];
+            if(!slot.name.empty())
+                return false;
+            slot = keyword;
+        }
+        return true;
+    }
+};
+
+inline constexpr KeywordTable keyword_table;
+
+struct OperatorMatch {
+    Token::Type type;
+    size_t      length; // 0 if no operator starts with this character.
+};
+
+// Longest operator at the start of [begin, end) (maximal munch): A two state DFA, as no operator is longer than two characters.
+constexpr OperatorMatch match_operator(const char* begin, const char* end) noexcept {
+    const char next = end - begin > 1 ? begin[1] : '\0';
+    const auto either = [next](char second, Token::Type two_chars, Token::Type one_char) -> OperatorMatch {
+        return next == second ? OperatorMatch{two_chars, 2} : OperatorMatch{one_char, 1};
+    };
+    switch(*begin) {
+        case '=': return either('=', Token::Type::Equal, Token::Type::Assignment);
+        case '!': return either('=', Token::Type::Different, Token::Type::Not);
+        case '>': return either('=', Token::Type::GreaterOrEqual, Token::Type::Greater);
+        case '<': return either('=', Token::Type::LesserOrEqual, Token::Type::Lesser);
+        case '+': return either('+', Token::Type::Increment, Token::Type::Addition);
+        case '-': return either('-', Token::Type::Decrement, Token::Type::Substraction);
+        case '&': return next == '&' ? OperatorMatch{Token::Type::And, 2} : OperatorMatch{Token::Type::Unknown, 0};
+        case '|': return next == '|' ? OperatorMatch{Token::Type::Or, 2} : OperatorMatch{Token::Type::Unknown, 0};
+        case '*': return {Token::Type::Multiplication, 1};
+        case '/': return {Token::Type::Division, 1};
+        case '^': return {Token::Type::Xor, 1};
+        case '%': return {Token::Type::Modulus, 1};
+        case '(': return {Token::Type::OpenParenthesis, 1};
+        case ')': return {Token::Type::CloseParenthesis, 1};
+        case '[': return {Token::Type::OpenSubscript, 1};
+        case ']': return {Token::Type::CloseSubscript, 1};
+        case '.': return {Token::Type::MemberAccess, 1};
+        case ':': return {Token::Type::Colon, 1};
+        default: return {Token::Type::Unknown, 0};
+    }
+}
+
+static_assert(keyword_table.find("function") && *keyword_table.find("function") == Token::Type::Function);
+static_assert(keyword_table.find("sizeof") && *keyword_table.find("sizeof") == Token::Type::Sizeof);
+static_assert(!keyword_table.find("functio") && !keyword_table.find("x"));
+static_assert(match_operator("<=", "<=" + 2).type == Token::Type::LesserOrEqual && match_operator("=-", "=-" + 2).length == 1);
+
+} // namespace token_tables
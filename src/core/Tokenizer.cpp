@@ -1,23 +1,5 @@
 ﻿#include "Tokenizer.hpp"
 
-void Tokenizer::advance() noexcept {
-    if(is_newline(peek()))
-        newline();
-    else
-        ++_current_column;
-    ++_current_pos;
-}
-
-void Tokenizer::newline() noexcept {
-    ++_current_line;
-    _current_column = 0;
-}
-
-void Tokenizer::skip_whitespace() noexcept {
-    while(!eof() && is_discardable(peek()))
-        advance();
-}
-
 Token Tokenizer::search_next() {
     auto type = Token::Type::Unknown;
     auto begin = _current_pos;
@@ -30,11 +12,11 @@ Token Tokenizer::search_next() {
             case '\'': {
                 type = Token::Type::CharLiteral;
                 if(eof())
-                    throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching ' on line {}.", _current_line), point_error(begin, _current_line, begin));
+                    throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching ' on line {}.", line(begin)), point_error(begin, begin));
                 if(peek() == '\\') { // Escaped character
                     advance();
                     if(eof())
-                        throw Exception(fmt::format("[Tokenizer] Error: Expected escape sequence, got EOF on line {}.", _current_line), point_error(begin, _current_line, begin));
+                        throw Exception(fmt::format("[Tokenizer] Error: Expected escape sequence, got EOF on line {}.", line(begin)), point_error(begin, begin));
                     size_t c = 0;
                     switch(peek()) {
                         case '\'': c = 1; break;
@@ -49,44 +31,37 @@ Token Tokenizer::search_next() {
                         case 't': c = 9; break;
                         case 'v': c = 10; break;
                         case '0': c = 11; break;
-                        default: throw Exception(fmt::format("[Tokenizer] Error: Unknown escape sequence \\'{}'.", peek()), point_error(_current_pos, _current_line, begin));
+                        default: throw Exception(fmt::format("[Tokenizer] Error: Unknown escape sequence \\'{}'.", peek()), point_error(_current_pos, begin));
                     }
                     advance();
                     if(eof() || peek() != '\'')
-                        throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching ' on line {}.", _current_line),
-                                        point_error(_current_column, _current_line));
+                        throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching ' on line {}.", line(_current_pos)), point_error(_current_pos));
                     advance(); // Skip '
-                    return Token{type, std::string_view{escaped_char + c, escaped_char + c + 1}, _current_line, _current_column - 1};
+                    return Token{type, std::string_view{escaped_char + c, escaped_char + c + 1}, static_cast<uint32_t>(begin + 1), _file_id};
                 } else {
                     advance();
                     if(eof() || peek() != '\'')
-                        throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching ' on line {}.", _current_line),
-                                        point_error(_current_column, _current_line));
+                        throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching ' on line {}.", line(_current_pos)), point_error(_current_pos));
                     advance(); // Skip '
-                    return Token{type, std::string_view{_source.begin() + begin + 1, _source.begin() + (_current_pos - 1)}, _current_line,
-                                 _current_column - ((_current_pos - 1) - (begin + 1))};
+                    return Token{type, std::string_view{_source.begin() + begin + 1, _source.begin() + (_current_pos - 1)}, static_cast<uint32_t>(begin + 1), _file_id};
                 }
                 break;
             }
             case '"': {
                 // For strings, the escape sequences will be handled by the Parser
-                while(!eof() && peek() != '"') {
-                    if(peek() == '\\') {
+                while(true) {
+                    _current_pos = scan(char_scan::find_either, '"', '\\');
+                    if(eof() || peek() == '"')
+                        break;
+                    advance(); // Skip '\\' and the escaped character.
+                    if(!eof())
                         advance();
-                        if(eof())
-                            break;
-                        if(peek() == '"')
-                            advance();
-                    }
-                    advance();
                 }
                 if(eof())
-                    throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching \" on line {}.", _current_line),
-                                    point_error(_current_column, _current_line));
+                    throw Exception(fmt::format("[Tokenizer] Error: Reached end of file without matching \" on line {}.", line(begin)), point_error(begin));
                 advance(); // Skip '"'
                 type = Token::Type::StringLiteral;
-                return Token{type, std::string_view{_source.begin() + begin + 1, _source.begin() + (_current_pos - 1)}, _current_line,
-                             _current_column - ((_current_pos - 1) - (begin + 1))};
+                return Token{type, std::string_view{_source.begin() + begin + 1, _source.begin() + (_current_pos - 1)}, static_cast<uint32_t>(begin + 1), _file_id};
             }
             case ',': type = Token::Type::Comma; break;
             case ';': type = Token::Type::EndStatement; break;
@@ -96,8 +71,7 @@ Token Tokenizer::search_next() {
                 // Comments, checks for a second /, fallthrough to the general case if not found.
                 if(!eof() && peek() == '/') {
                     type = Token::Type::Comment;
-                    while(!eof() && peek() != '\n')
-                        advance();
+                    _current_pos = scan(char_scan::find, '\n');
                     break;
                 }
                 [[fallthrough]];
@@ -111,20 +85,20 @@ Token Tokenizer::search_next() {
                             case 'u': [[fallthrough]];
                             case 'i':
                                 if(force_integer || force_float)
-                                    throw Exception(fmt::format("[Tokenizer] Error: Unexpected supernumerary '{}' in literal constant on line {}.", peek(), _current_line),
-                                                    point_error(_current_column, _current_line));
+                                    throw Exception(fmt::format("[Tokenizer] Error: Unexpected supernumerary '{}' in literal constant on line {}.", peek(), line(_current_pos)),
+                                                    point_error(_current_pos));
                                 force_integer = true;
                                 break;
                             case 'f':
                                 if(force_float || force_integer)
-                                    throw Exception(fmt::format("[Tokenizer] Error: Unexpected supernumerary 'f' in float constant on line {}.", _current_line),
-                                                    point_error(_current_column, _current_line));
+                                    throw Exception(fmt::format("[Tokenizer] Error: Unexpected supernumerary 'f' in float constant on line {}.", line(_current_pos)),
+                                                    point_error(_current_pos));
                                 force_float = true;
                                 break;
                             case '.':
                                 if(found_decimal_separator || force_integer)
-                                    throw Exception(fmt::format("[Tokenizer] Error: Unexpected supernumerary '.' in float constant on line {}.", _current_line),
-                                                    point_error(_current_column, _current_line));
+                                    throw Exception(fmt::format("[Tokenizer] Error: Unexpected supernumerary '.' in float constant on line {}.", line(_current_pos)),
+                                                    point_error(_current_pos));
                                 found_decimal_separator = true;
                                 break;
                         }
@@ -132,32 +106,28 @@ Token Tokenizer::search_next() {
                     }
                     type = (force_float || found_decimal_separator) ? Token::Type::Float : Token::Type::Digits;
                 } else {
-                    auto temp_cursor = _current_pos;
                     // Operators
-                    while(!eof() && !is_discardable(_source[temp_cursor]) && is_allowed_in_operators(_source[temp_cursor]))
-                        ++temp_cursor;
-                    const auto end = temp_cursor;
-                    while(temp_cursor != begin && !operators.contains(std::string_view{_source.begin() + begin, _source.begin() + temp_cursor}))
-                        --temp_cursor;
-                    if(temp_cursor == begin)
+                    const auto match = token_tables::match_operator(_source.data() + begin, _source.data() + _source.length());
+                    if(match.length == 0) {
+                        auto end = _current_pos;
+                        while(end < _source.length() && is_allowed_in_operators(_source[end]))
+                            ++end;
                         throw Exception(fmt::format("[Tokenizer] Error: No matching operator for '{}'.", std::string_view{_source.begin() + begin, _source.begin() + end}),
-                                        point_error((temp_cursor - _current_pos) + _current_column, _current_line));
-                    type = operators.find(std::string_view{_source.begin() + begin, _source.begin() + temp_cursor})->second;
-                    // Sync our cursor with the temp one.
-                    while(_current_pos != temp_cursor)
-                        advance();
+                                        point_error(begin));
+                    }
+                    type = match.type;
+                    _current_pos = begin + match.length;
                 }
             }
         }
     } else {
-        while(!eof() && (is_allowed_in_identifiers(peek()) || is_digit(peek())))
-            advance();
+        _current_pos = scan(char_scan::skip_identifier);
 
         const std::string_view str{_source.begin() + begin, _source.begin() + _current_pos};
-        if(auto it = keywords.find(str); it != keywords.end())
-            type = it->second;
+        if(const auto keyword = token_tables::keyword_table.find(str))
+            type = *keyword;
         else
             type = Token::Type::Identifier;
     }
-    return Token{type, std::string_view{_source.begin() + begin, _source.begin() + _current_pos}, _current_line, _current_column - (_current_pos - begin)};
+    return Token{type, std::string_view{_source.begin() + begin, _source.begin() + _current_pos}, static_cast<uint32_t>(begin), _file_id};
 }
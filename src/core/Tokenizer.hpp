@@ -2,18 +2,23 @@
 
 #include <array>
 #include <cassert>
-#include <het_unordered_map.hpp>
 #include <string>
 #include <string_view>
 
+#include <CharScan.hpp>
 #include <Exception.hpp>
 #include <Logger.hpp>
 #include <Source.hpp>
 #include <Token.hpp>
+#include <TokenTables.hpp>
 
 class Tokenizer {
   public:
-    Tokenizer(const std::string& source) : _source(source) { skip_whitespace(); }
+    Tokenizer(std::string_view source, SourceFile::ID file_id = 0) : _source(source), _file_id(file_id) {
+        assert(source.length() <= std::numeric_limits<uint32_t>::max()); // Token offsets are 32-bit.
+        skip_whitespace();
+    }
+    explicit Tokenizer(const SourceFile& file) : Tokenizer(file.content(), file.id()) {}
 
     Token consume() {
         auto t = search_next();
@@ -28,21 +33,24 @@ class Tokenizer {
     inline bool is_discardable(char c) const noexcept { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
     inline bool is_allowed_in_identifiers(char c) const noexcept { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_'; }
     inline bool is_digit(char c) const noexcept { return c >= '0' && c <= '9'; }
-    bool        is_newline(char c) const noexcept { return c == '\n'; }
 
     bool        eof() const noexcept { return _current_pos >= _source.length(); }
     inline char peek() const noexcept { return _source[_current_pos]; }
 
-    void advance() noexcept;
-    void newline() noexcept;
-    void skip_whitespace() noexcept;
+    inline void advance() noexcept { ++_current_pos; }
+    void        skip_whitespace() noexcept { _current_pos = scan(char_scan::skip_whitespace); }
+    // Position of the first character from the current one where the run scanned by a char_scan function ends.
+    size_t scan(auto scanner, auto... args) const noexcept {
+        return static_cast<size_t>(scanner(_source.data() + _current_pos, _source.data() + _source.length(), args...) - _source.data());
+    }
 
     Token search_next();
 
-    // Display a hint to the origin of an error.
-    std::string point_error(size_t at, size_t line, size_t from = (std::numeric_limits<size_t>::max)(), size_t to = (std::numeric_limits<size_t>::max)()) const noexcept {
-        return ::point_error(_source, at, line, from, to);
+    // Display a hint to the origin of an error. Lines are not tracked while scanning: Positions are only resolved here.
+    std::string point_error(size_t at, size_t from = (std::numeric_limits<size_t>::max)(), size_t to = (std::numeric_limits<size_t>::max)()) const noexcept {
+        return ::point_error(LineTable{_source}, at, from, to);
     }
+    size_t line(size_t offset) const noexcept { return LineTable{_source}.line(offset); }
 
     static constexpr std::string_view control_chars = ";{}";
     static constexpr std::string_view operators_chars = ".=*/+-^!<>&|%()[]";
@@ -50,44 +58,7 @@ class Tokenizer {
     static inline bool    is_allowed_in_operators(char c) { return operators_chars.find(c) != operators_chars.npos; }
     static constexpr char escaped_char[] = {'?', '\'', '\"', '\?', '\a', '\b', '\f', '\n', '\r', '\t', '\v', '\0'};
 
-    const het_unordered_map<Token::Type> operators{
-        {"=", Token::Type::Assignment},
-        {"*", Token::Type::Multiplication},
-        {"+", Token::Type::Addition},
-        {"-", Token::Type::Substraction},
-        {"/", Token::Type::Division},
-        {"^", Token::Type::Xor},
-        {"==", Token::Type::Equal},
-        {"!=", Token::Type::Different},
-        {"!", Token::Type::Not},
-        {">", Token::Type::Greater},
-        {"<", Token::Type::Lesser},
-        {">=", Token::Type::GreaterOrEqual},
-        {"<=", Token::Type::LesserOrEqual},
-        {"&&", Token::Type::And},
-        {"||", Token::Type::Or},
-        {"%", Token::Type::Modulus},
-        {"++", Token::Type::Increment},
-        {"--", Token::Type::Decrement},
-        {"(", Token::Type::OpenParenthesis},
-        {")", Token::Type::CloseParenthesis},
-        {"[", Token::Type::OpenSubscript},
-        {"]", Token::Type::CloseSubscript},
-        {".", Token::Type::MemberAccess},
-        {":", Token::Type::Colon},
-    };
-
-    const het_unordered_map<Token::Type> keywords{
-        {"function", Token::Type::Function}, {"let", Token::Type::Let},          {"return", Token::Type::Return},   {"if", Token::Type::If},
-        {"else", Token::Type::Else},         {"while", Token::Type::While},      {"for", Token::Type::For},         {"bool", Token::Type::Identifier},
-        {"int", Token::Type::Identifier},    {"float", Token::Type::Identifier}, {"char", Token::Type::Identifier}, {"true", Token::Type::Boolean},
-        {"false", Token::Type::Boolean},     {"const", Token::Type::Const},      {"import", Token::Type::Import},   {"export", Token::Type::Export},
-        {"extern", Token::Type::Extern},     {"type", Token::Type::Type},        {"and", Token::Type::And},         {"or", Token::Type::Or},
-        {"sizeof", Token::Type::Sizeof},
-    };
-
-    const std::string& _source;
-    size_t             _current_pos = 0;
-    size_t             _current_line = 0;
-    size_t             _current_column = 0;
+    std::string_view _source;
+    SourceFile::ID   _file_id;
+    size_t           _current_pos = 0;
 };
@@ -1,13 +1,15 @@
 #include <array>
 #include <chrono>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <string_view>
 
 #include <Logger.hpp>
 #include <Parser.hpp>
+#include <Source.hpp>
+#include <TokenStream.hpp>
 #include <Tokenizer.hpp>
 #include <utils/CLIArg.hpp>
 
@@ -33,10 +35,9 @@ int main(int argc, char* argv[]) {
 
     Indenter log;
 
-    std::vector<std::string> lines;
-    std::vector<Token>       tokens;
-    AST                      ast;
-    Parser                   parser;
+    std::vector<std::shared_ptr<const SourceFile>> sources; // Kept for the lifetime of the AST: Its tokens point into them.
+    AST                                            ast;
+    Parser                                         parser;
     // Interpreter                   interpreter;
     std::string input;
 
@@ -45,21 +46,17 @@ int main(int argc, char* argv[]) {
     bool debug = false;
 
     auto load = [&](const auto& path) {
-        std::ifstream file(path);
-        if(!file) {
+        // Not mapped: The file could be modified while the REPL still uses it.
+        auto source = SourceManager::instance().load(path, false);
+        if(!source) {
             error("[repl::load] Couldn't open file '{}' (Running from {}).\n", path, std::filesystem::current_path().string());
             return;
         }
-        lines.push_back(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
-        auto& source = lines.back();
+        sources.push_back(source);
         log.group();
         log.print("Parsing '{}'...\n", path);
-        Tokenizer tokenizer(source);
-        auto      first = tokens.size();
-        while(tokenizer.has_more())
-            tokens.push_back(tokenizer.consume());
-
-        auto newNode = parser.parse(std::span<Token>{tokens.begin() + first, tokens.end()}, ast);
+        TokenStream tokens(*source);
+        auto        newNode = parser.parse(tokens, ast);
         if(newNode) {
             log.group();
             log.print("Executing ({}) using Interpreter...\n", newNode->type);
@@ -77,7 +74,6 @@ int main(int argc, char* argv[]) {
         load(args.get_default_arg());
     }
 
-    lines.reserve(64 * 1024); // FIXME: Tokens are referencing these strings, this is a workaround to avoid reallocation of the vector, which would be fatal :)
     do {
         input = prompt.get_line();
 
@@ -97,8 +93,7 @@ int main(int argc, char* argv[]) {
         } else if(input == "dump") {
             fmt::print("{}", ast);
         } else if(input == "clear") {
-            lines.clear();
-            tokens.clear();
+            sources.clear();
             ast = {};
             parser = {};
             // interpreter = {};
@@ -113,12 +108,11 @@ int main(int argc, char* argv[]) {
         } else if(input == "debug") {
             debug = !debug;
         } else {
-            lines.push_back(input);
-            auto& line = lines.back();
+            const auto& line = *sources.emplace_back(SourceManager::instance().add("<repl>", input));
 
             log.group();
-            Tokenizer tokenizer(line);
-            auto      first = tokens.size();
+            Tokenizer          tokenizer(line);
+            std::vector<Token> tokens;
             try {
                 while(tokenizer.has_more()) {
                     auto t = tokenizer.consume();
@@ -127,7 +121,7 @@ int main(int argc, char* argv[]) {
                     tokens.push_back(t);
                 }
 
-                auto newNode = parser.parse(std::span<Token>{tokens.begin() + first, tokens.end()}, ast);
+                auto newNode = parser.parse(tokens, ast);
                 if(newNode) {
                     log.group();
                     log.print("Executing ({}) using Interpreter...\n", newNode->type);
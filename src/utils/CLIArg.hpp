@@ -1,3 +1,4 @@
+#include <cassert>
 #include <string>
 #include <vector>
 
@@ -28,6 +29,14 @@ class CLIArg {
         _arguments.push_back({.short_name = short_name, .long_name = long_name, .min_values = min_values, .max_values = max_values, .description = description});
     }
     bool parse(int argc, char* argv[]);
+    // Forgets the result of a previous parse, the same options can then be parsed again.
+    void reset() {
+        _default_args.clear();
+        for(auto& a : _arguments) {
+            a.set = false;
+            a.values.clear();
+        }
+    }
 
     const ArgumentDescription& operator[](char c) const { return *get_short(c); }
     const ArgumentDescription& operator[](const std::string& c) const { return *get_long(c.c_str()); }
@@ -39,7 +48,10 @@ class CLIArg {
     void print_help() const {
         print("  [{}] Help:\n", _program_name);
         for(const ArgumentDescription& d : _arguments)
-            print("    -{}  --{:8} {}\n", d.short_name, d.long_name, d.description);
+            if(d.short_name != '\0')
+                print("    -{}  --{:8} {}\n", d.short_name, d.long_name, d.description);
+            else // Long name only
+                print("        --{:8} {}\n", d.long_name, d.description);
     }
 
   private:
@@ -88,10 +100,17 @@ bool CLIArg::parse(int argc, char* argv[]) {
     while(idx < argc) {
         if(argv[idx][0] == '-') {
             if(argv[idx][1] == '-') {
-                auto a = get_long(argv[idx] + 2);
+                // The value may also be attached to the option (e.g. --out=file).
+                std::string name = argv[idx] + 2;
+                const auto  separator = name.find('=');
+                auto        a = get_long(name.substr(0, separator).c_str());
                 if(!a) {
                     warn("[CLIArg] Unknown argument '{}'.\n", argv[idx] + 2);
                     ++idx;
+                } else if(separator != std::string::npos) {
+                    a->set = true;
+                    a->values.push_back(name.substr(separator + 1));
+                    ++idx;
                 } else {
                     a->set = true;
                     ++idx;
@@ -116,6 +135,11 @@ bool CLIArg::parse(int argc, char* argv[]) {
                         warn("[CLIArg] Unknown argument '{}'.\n", argv[idx] + p);
                     } else {
                         a->set = true;
+                        // Options requiring a value may be directly followed by it (e.g. -O2).
+                        if(a->min_values > 0 && argv[idx][p + 1] != '\0') {
+                            a->values.push_back(argv[idx] + p + 1);
+                            break;
+                        }
                         if(a->max_values > 0) {
                             while(next_arg < argc && a->values.size() < a->max_values && argv[next_arg][0] != '-') {
                                 a->values.push_back(argv[next_arg]);
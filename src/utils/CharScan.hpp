@@ -0,0 +1,149 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LANG_CHAR_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LANG_CHAR_SCAN_SSE2
+#endif
+
+// Bulk character classification, used by the Tokenizer to jump over runs of whitespace, identifier characters, comments and string bodies.
+// Processes 32 (AVX2) or 16 (SSE2) bytes at a time, depending on the instruction sets enabled at compile time (e.g. -mavx2 or /arch:AVX2), with a scalar fallback.
+// All functions take a [begin, end) range and return a pointer in it, end if the searched character was not found.
+namespace char_scan {
+
+inline bool is_whitespace(char c) noexcept { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+inline bool is_identifier(char c) noexcept { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_'; }
+
+namespace detail {
+// Most runs are short (a single space, an identifier...): Blocks only pay off past their first bytes, which are checked one at a time.
+constexpr size_t short_run = 8;
+} // namespace detail
+
+#if defined(LANG_CHAR_SCAN_AVX2) || defined(LANG_CHAR_SCAN_SSE2)
+namespace detail {
+#ifdef LANG_CHAR_SCAN_AVX2
+using Block = __m256i;
+constexpr size_t block_size = 32;
+inline Block     load(const char* p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Block     equal(Block b, char c) noexcept { return _mm256_cmpeq_epi8(b, _mm256_set1_epi8(c)); }
+inline Block     greater(Block b, char c) noexcept { return _mm256_cmpgt_epi8(b, _mm256_set1_epi8(c)); } // Signed: Bytes >= 0x80 are never greater than an ASCII character.
+inline Block     lesser(Block b, char c) noexcept { return _mm256_cmpgt_epi8(_mm256_set1_epi8(c), b); }
+inline Block     bit_or(Block lhs, Block rhs) noexcept { return _mm256_or_si256(lhs, rhs); }
+inline Block     bit_and(Block lhs, Block rhs) noexcept { return _mm256_and_si256(lhs, rhs); }
+inline Block     to_lower(Block b) noexcept { return _mm256_or_si256(b, _mm256_set1_epi8(0x20)); }
+inline uint32_t  mask(Block b) noexcept { return static_cast<uint32_t>(_mm256_movemask_epi8(b)); }
+constexpr uint32_t full_mask = 0xFFFFFFFFu;
+#else
+using Block = __m128i;
+constexpr size_t block_size = 16;
+inline Block     load(const char* p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Block     equal(Block b, char c) noexcept { return _mm_cmpeq_epi8(b, _mm_set1_epi8(c)); }
+inline Block     greater(Block b, char c) noexcept { return _mm_cmpgt_epi8(b, _mm_set1_epi8(c)); } // Signed: Bytes >= 0x80 are never greater than an ASCII character.
+inline Block     lesser(Block b, char c) noexcept { return _mm_cmplt_epi8(b, _mm_set1_epi8(c)); }
+inline Block     bit_or(Block lhs, Block rhs) noexcept { return _mm_or_si128(lhs, rhs); }
+inline Block     bit_and(Block lhs, Block rhs) noexcept { return _mm_and_si128(lhs, rhs); }
+inline Block     to_lower(Block b) noexcept { return _mm_or_si128(b, _mm_set1_epi8(0x20)); }
+inline uint32_t  mask(Block b) noexcept { return static_cast<uint32_t>(_mm_movemask_epi8(b)); }
+constexpr uint32_t full_mask = 0xFFFFu;
+#endif
+
+inline uint32_t whitespace_mask(Block b) noexcept { return mask(bit_or(bit_or(equal(b, ' '), equal(b, '\n')), bit_or(equal(b, '\r'), equal(b, '\t')))); }
+
+inline uint32_t identifier_mask(Block b) noexcept {
+    const auto lower = to_lower(b); // Only maps 'A'-'Z' to 'a'-'z' among the characters which could then be in the range.
+    const auto letter = bit_and(greater(lower, 'a' - 1), lesser(lower, 'z' + 1));
+    const auto digit = bit_and(greater(b, '0' - 1), lesser(b, '9' + 1));
+    return mask(bit_or(bit_or(letter, digit), equal(b, '_')));
+}
+
+// First byte for which the bit returned by stop is set. Only processes whole blocks: The remaining bytes (less than a block) are left to the caller.
+template<typename Stop>
+inline const char* find_first(const char* begin, const char* end, Stop stop) noexcept {
+    while(end - begin >= static_cast<ptrdiff_t>(block_size)) {
+        if(const auto m = stop(load(begin)); m != 0)
+            return begin + std::countr_zero(m);
+        begin += block_size;
+    }
+    return begin;
+}
+} // namespace detail
+#endif
+
+// Returns true if the first characters of the range (up to short_run) were enough to find the end of the run (then stored in begin).
+template<typename Predicate>
+inline bool skip_short_run(const char*& begin, const char* end, Predicate skip) noexcept {
+    const auto short_end = end - begin > static_cast<ptrdiff_t>(detail::short_run) ? begin + detail::short_run : end;
+    while(begin != short_end && skip(*begin))
+        ++begin;
+    return begin != end && !skip(*begin);
+}
+
+// First non-whitespace character.
+inline const char* skip_whitespace(const char* begin, const char* end) noexcept {
+    if(skip_short_run(begin, end, is_whitespace))
+        return begin;
+#if defined(LANG_CHAR_SCAN_AVX2) || defined(LANG_CHAR_SCAN_SSE2)
+    begin = detail::find_first(begin, end, [](detail::Block b) { return detail::whitespace_mask(b) ^ detail::full_mask; });
+#endif
+    while(begin != end && is_whitespace(*begin))
+        ++begin;
+    return begin;
+}
+
+// First character not allowed in identifiers ([A-Za-z0-9_]).
+inline const char* skip_identifier(const char* begin, const char* end) noexcept {
+    if(skip_short_run(begin, end, is_identifier))
+        return begin;
+#if defined(LANG_CHAR_SCAN_AVX2) || defined(LANG_CHAR_SCAN_SSE2)
+    begin = detail::find_first(begin, end, [](detail::Block b) { return detail::identifier_mask(b) ^ detail::full_mask; });
+#endif
+    while(begin != end && is_identifier(*begin))
+        ++begin;
+    return begin;
+}
+
+// First occurrence of c.
+inline const char* find(const char* begin, const char* end, char c) noexcept {
+    if(skip_short_run(begin, end, [c](char x) { return x != c; }))
+        return begin;
+#if defined(LANG_CHAR_SCAN_AVX2) || defined(LANG_CHAR_SCAN_SSE2)
+    begin = detail::find_first(begin, end, [c](detail::Block b) { return detail::mask(detail::equal(b, c)); });
+#endif
+    while(begin != end && *begin != c)
+        ++begin;
+    return begin;
+}
+
+// First occurrence of either a or b.
+inline const char* find_either(const char* begin, const char* end, char a, char b) noexcept {
+    if(skip_short_run(begin, end, [a, b](char x) { return x != a && x != b; }))
+        return begin;
+#if defined(LANG_CHAR_SCAN_AVX2) || defined(LANG_CHAR_SCAN_SSE2)
+    begin = detail::find_first(begin, end, [a, b](detail::Block block) { return detail::mask(detail::bit_or(detail::equal(block, a), detail::equal(block, b))); });
+#endif
+    while(begin != end && *begin != a && *begin != b)
+        ++begin;
+    return begin;
+}
+
+// Number of occurrences of c.
+inline size_t count(const char* begin, const char* end, char c) noexcept {
+    size_t r = 0;
+#if defined(LANG_CHAR_SCAN_AVX2) || defined(LANG_CHAR_SCAN_SSE2)
+    while(end - begin >= static_cast<ptrdiff_t>(detail::block_size)) {
+        r += static_cast<size_t>(std::popcount(detail::mask(detail::equal(detail::load(begin), c))));
+        begin += detail::block_size;
+    }
+#endif
+    while(begin != end)
+        r += *begin++ == c;
+    return r;
+}
+
+} // namespace char_scan
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+#include <MappedFile.hpp>
+
+// Fast non-cryptographic 64-bit hash (MurmurHash64A), used to key cached compilation results on content rather than timestamps.
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0) {
+    constexpr uint64_t m = 0xc6a4a7935bd1e995ull;
+    constexpr int      r = 47;
+
+    uint64_t    h = seed ^ (size * m);
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    const auto* end = bytes + (size / 8) * 8;
+    for(; bytes != end; bytes += 8) {
+        uint64_t k;
+        std::memcpy(&k, bytes, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    switch(size & 7) {
+        case 7: h ^= uint64_t(bytes[6]) << 48; [[fallthrough]];
+        case 6: h ^= uint64_t(bytes[5]) << 40; [[fallthrough]];
+        case 5: h ^= uint64_t(bytes[4]) << 32; [[fallthrough]];
+        case 4: h ^= uint64_t(bytes[3]) << 24; [[fallthrough]];
+        case 3: h ^= uint64_t(bytes[2]) << 16; [[fallthrough]];
+        case 2: h ^= uint64_t(bytes[1]) << 8; [[fallthrough]];
+        case 1:
+            h ^= uint64_t(bytes[0]);
+            h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+inline uint64_t hash_bytes(std::string_view str, uint64_t seed = 0) {
+    return hash_bytes(str.data(), str.size(), seed);
+}
+
+// Combines several values into a single hash. Order matters.
+class Hasher {
+  public:
+    Hasher& add(std::string_view str) {
+        // Also hash the size so ("ab", "c") and ("a", "bc") differ.
+        add(static_cast<uint64_t>(str.size()));
+        _hash = hash_bytes(str, _hash);
+        return *this;
+    }
+    Hasher& add(uint64_t value) {
+        _hash = hash_bytes(&value, sizeof(value), _hash);
+        return *this;
+    }
+
+    uint64_t value() const { return _hash; }
+
+  private:
+    uint64_t _hash = 0xcbf29ce484222325ull;
+};
+
+// Hashes the file in place, it is mapped rather than copied. Returns std::nullopt if the file cannot be read.
+inline std::optional<uint64_t> hash_file(const std::filesystem::path& path) {
+    MappedFile file;
+    if(!file.open(path))
+        return std::nullopt;
+    return hash_bytes(file.view());
+}
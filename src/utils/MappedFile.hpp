@@ -0,0 +1,98 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path) { open(path); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if(this != &o) {
+            close();
+            std::swap(_data, o._data);
+            std::swap(_size, o._size);
+        }
+        return *this;
+    }
+    ~MappedFile() { close(); }
+
+    // Returns true on success
+    bool open(const std::filesystem::path& path) {
+        close();
+#ifdef WIN32
+        auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            return false;
+        }
+        _size = static_cast<size_t>(size.QuadPart);
+        if(_size > 0) {
+            auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(mapping) {
+                _data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        _size = static_cast<size_t>(st.st_size);
+        if(_size > 0) {
+            auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            _data = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+        }
+        ::close(fd);
+#endif
+        if(_size > 0 && !_data) {
+            _size = 0;
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if(_data) {
+#ifdef WIN32
+            UnmapViewOfFile(_data);
+#else
+            munmap(const_cast<char*>(_data), _size);
+#endif
+        }
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const char*      data() const { return _data; }
+    size_t           size() const { return _size; }
+    std::string_view view() const { return {_data, _size}; }
+
+  private:
+    const char* _data = nullptr;
+    size_t      _size = 0;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Resident set size of the process, in bytes. 0 if unavailable.
+inline int64_t get_current_rss() {
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return static_cast<int64_t>(counters.WorkingSetSize);
+#else
+    // Second field of statm: Resident pages.
+    auto file = std::fopen("/proc/self/statm", "r");
+    if(!file)
+        return 0;
+    long long size = 0, resident = 0;
+    const auto read = std::fscanf(file, "%lld %lld", &size, &resident);
+    std::fclose(file);
+    return read == 2 ? resident * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+// Highest resident set size of the process so far, in bytes. 0 if unavailable.
+inline int64_t get_peak_rss() {
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return static_cast<int64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024; // In KiB on Linux.
+#endif
+}
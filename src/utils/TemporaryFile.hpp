@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Creates path, failing if it already exists. Returns false on failure, with errno set to EEXIST if it did exist.
+inline bool create_file_exclusively(const std::filesystem::path& path) {
+#ifdef WIN32
+    const auto file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        errno = GetLastError() == ERROR_FILE_EXISTS ? EEXIST : EIO;
+        return false;
+    }
+    CloseHandle(file);
+#else
+    const auto file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if(file < 0)
+        return false;
+    ::close(file);
+#endif
+    return true;
+}
+
+// Returns a path next to target, unique across threads and processes, to be written and then renamed over target.
+// The file is created (empty) before returning, so two writers can't end up sharing it; if it can't be created, writing to it will report the error.
+inline std::filesystem::path make_temporary_path(const std::filesystem::path& target) {
+    static std::atomic<uint64_t> counter = 0;
+#ifdef WIN32
+    const auto process_id = static_cast<uint64_t>(GetCurrentProcessId());
+#else
+    const auto process_id = static_cast<uint64_t>(getpid());
+#endif
+    while(true) {
+        const auto now = static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        const auto unique = now ^ (std::hash<std::thread::id>{}(std::this_thread::get_id()) << 1) ^ (counter++ << 48);
+        auto       r = target;
+        r += ".tmp" + std::to_string(process_id) + "_" + std::to_string(unique);
+        if(create_file_exclusively(r) || errno != EEXIST)
+            return r;
+    }
+}
+
+// Renames the fully written temporary file over target: Readers will either see the previous version or the complete new one.
+// Returns true on success
+inline bool commit_temporary_file(const std::filesystem::path& temporary, const std::filesystem::path& target) {
+    std::error_code ec;
+    std::filesystem::rename(temporary, target, ec);
+    if(ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Minimal fixed-size pool of worker threads consuming a FIFO queue of tasks.
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t thread_count) {
+        if(thread_count == 0)
+            thread_count = 1;
+        _workers.reserve(thread_count);
+        for(size_t i = 0; i < thread_count; ++i)
+            _workers.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        _condition.notify_all();
+        for(auto& worker : _workers)
+            worker.join();
+    }
+
+    size_t size() const { return _workers.size(); }
+
+    // Exceptions thrown by the task are forwarded to the returned future.
+    template<typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& task) {
+        auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard lock(_mutex);
+            _tasks.emplace([packaged] { (*packaged)(); });
+        }
+        _condition.notify_one();
+        return future;
+    }
+
+  private:
+    std::vector<std::thread>          _workers;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex                        _mutex;
+    std::condition_variable           _condition;
+    bool                              _stopping = false;
+
+    void work() {
+        while(true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(_mutex);
+                _condition.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+                if(_stopping && _tasks.empty())
+                    return;
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+            task();
+        }
+    }
+};
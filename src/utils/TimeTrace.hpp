@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <MemoryUsage.hpp>
+
+// Compile time profiling. Spans recorded by TimeTraceScope are written as Chrome trace events (chrome://tracing, ui.perfetto.dev),
+// or aggregated by name in a report. Recording is disabled by default: A scope then only costs an atomic load.
+class TimeTrace {
+  public:
+    struct Event {
+        std::string name;                // What is done: "Parse", "Codegen function"...
+        std::string detail;              // On what: File, function or pass name.
+        int64_t     start = 0;           // In microseconds, since the trace was enabled.
+        int64_t     duration = 0;        // In microseconds.
+        uint32_t    thread = 0;
+        int64_t     rss = 0;             // Resident set size at the end of the span, in bytes, when sampled.
+        int64_t     peak_rss_growth = 0; // Growth of the peak resident set size of the process during the span, in bytes, when sampled.
+    };
+
+    static TimeTrace& instance() {
+        static TimeTrace time_trace;
+        return time_trace;
+    }
+
+    // sample_memory: Also record the resident set size at the end of each span, and the growth of its peak (costs a few system calls).
+    void enable(bool sample_memory = false) {
+        std::lock_guard lock(_mutex);
+        _origin = std::chrono::steady_clock::now();
+        _enabled = true;
+        if(sample_memory)
+            _sample_memory = true;
+    }
+    bool is_enabled() const { return _enabled.load(std::memory_order_relaxed); }
+    bool is_sampling_memory() const { return _sample_memory.load(std::memory_order_relaxed); }
+
+    int64_t now() const { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _origin).count(); }
+
+    void add(Event&& event) {
+        event.thread = thread_index();
+        std::lock_guard lock(_mutex);
+        _events.push_back(std::move(event));
+    }
+
+    // Forgets the recorded events, should be called at the start of each run.
+    void clear() {
+        std::lock_guard lock(_mutex);
+        _events.clear();
+        _origin = std::chrono::steady_clock::now();
+    }
+
+    // Returns true on success
+    bool write_chrome_trace(const std::filesystem::path& path) const {
+        std::ofstream file(path);
+        if(!file)
+            return false;
+        std::lock_guard lock(_mutex);
+        uint32_t        thread_count = 0;
+        file << "{\"traceEvents\":[\n";
+        for(const auto& event : _events) {
+            file << fmt::format(R"({{"name":"{}","cat":"compiler","ph":"X","pid":1,"tid":{},"ts":{},"dur":{})", escape(event.name), event.thread, event.start, event.duration);
+            if(!event.detail.empty() || event.rss > 0) {
+                file << R"(,"args":{)";
+                if(!event.detail.empty())
+                    file << fmt::format(R"("detail":"{}"{})", escape(event.detail), event.rss > 0 ? "," : "");
+                if(event.rss > 0)
+                    file << fmt::format(R"("rss_mib":{:.1f})", event.rss / (1024.0 * 1024.0));
+                file << "}";
+            }
+            file << "},\n";
+            thread_count = std::max(thread_count, event.thread + 1);
+        }
+        for(uint32_t thread = 0; thread < thread_count; ++thread)
+            file << fmt::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}},)", thread, thread == 0 ? "Main thread" : fmt::format("Thread {}", thread))
+                 << "\n";
+        file << R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"compiler"}})" << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    struct Summary {
+        std::string name;
+        size_t      count = 0;
+        int64_t     total = 0; // In microseconds.
+        int64_t     max = 0;
+        std::string max_detail;
+        int64_t     max_rss = 0;             // In bytes, highest resident set size sampled at the end of these spans (Not their peak).
+        int64_t     max_peak_rss_growth = 0; // In bytes, largest growth of the peak resident set size during one of these spans.
+    };
+
+    // Events aggregated by name, from the most time consuming.
+    std::vector<Summary> summarize() const {
+        std::map<std::string, Summary> summaries;
+        {
+            std::lock_guard lock(_mutex);
+            for(const auto& event : _events) {
+                auto& summary = summaries[event.name];
+                summary.name = event.name;
+                ++summary.count;
+                summary.total += event.duration;
+                summary.max_rss = std::max(summary.max_rss, event.rss);
+                summary.max_peak_rss_growth = std::max(summary.max_peak_rss_growth, event.peak_rss_growth);
+                if(event.duration > summary.max) {
+                    summary.max = event.duration;
+                    summary.max_detail = event.detail;
+                }
+            }
+        }
+        std::vector<Summary> r;
+        for(auto& [name, summary] : summaries)
+            r.push_back(std::move(summary));
+        std::sort(r.begin(), r.end(), [](const auto& lhs, const auto& rhs) { return lhs.total > rhs.total; });
+        return r;
+    }
+
+    std::string json_report(int64_t wall_time) const {
+        std::string r = fmt::format("{{\"wall_time_ms\":{:.3f},\"phases\":[", wall_time / 1000.0);
+        bool        first = true;
+        for(const auto& summary : summarize()) {
+            r += fmt::format(R"({}{{"name":"{}","count":{},"total_ms":{:.3f},"max_ms":{:.3f},"max_detail":"{}"}})", first ? "" : ",", escape(summary.name), summary.count,
+                             summary.total / 1000.0, summary.max / 1000.0, escape(summary.max_detail));
+            first = false;
+        }
+        return r + "]}\n";
+    }
+
+    std::string text_report(int64_t wall_time) const {
+        std::string r = fmt::format(" {:<24} | {:>8} | {:>12} | {:>12} | {}\n", "Phase", "Count", "Total", "Max", "Slowest");
+        for(const auto& summary : summarize())
+            r += fmt::format(" {:<24} | {:>8} | {:>10.2f}ms | {:>10.2f}ms | {}\n", summary.name, summary.count, summary.total / 1000.0, summary.max / 1000.0, summary.max_detail);
+        r += fmt::format(" Wall time: {:.2f}ms (phases overlap, and are summed across threads)\n", wall_time / 1000.0);
+        return r;
+    }
+
+  private:
+    TimeTrace() = default;
+
+    mutable std::mutex                    _mutex;
+    std::atomic<bool>                     _enabled = false;
+    std::atomic<bool>                     _sample_memory = false;
+    std::chrono::steady_clock::time_point _origin = std::chrono::steady_clock::now();
+    std::vector<Event>                    _events;
+    std::atomic<uint32_t>                 _thread_count = 0;
+
+    // Small, stable identifiers, in order of the first recorded event of each thread.
+    uint32_t thread_index() {
+        thread_local uint32_t index = _thread_count++;
+        return index;
+    }
+
+    static std::string escape(std::string_view str) {
+        std::string r;
+        r.reserve(str.size());
+        for(const auto c : str) {
+            if(c == '"' || c == '\\')
+                r += '\\';
+            if(static_cast<unsigned char>(c) < 0x20)
+                r += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+            else
+                r += c;
+        }
+        return r;
+    }
+};
+
+// Records the duration of its lifetime, if the time trace is enabled.
+class TimeTraceScope {
+  public:
+    explicit TimeTraceScope(std::string_view name, std::string_view detail = {}) {
+        auto& time_trace = TimeTrace::instance();
+        if(!time_trace.is_enabled())
+            return;
+        _event.name = name;
+        _event.detail = detail;
+        _event.start = time_trace.now();
+        _enabled = true;
+        if(time_trace.is_sampling_memory())
+            _peak_rss_at_start = get_peak_rss();
+    }
+    TimeTraceScope(const TimeTraceScope&) = delete;
+    TimeTraceScope& operator=(const TimeTraceScope&) = delete;
+
+    ~TimeTraceScope() {
+        if(!_enabled)
+            return;
+        auto& time_trace = TimeTrace::instance();
+        _event.duration = time_trace.now() - _event.start;
+        if(time_trace.is_sampling_memory()) {
+            _event.rss = get_current_rss();
+            _event.peak_rss_growth = get_peak_rss() - _peak_rss_at_start;
+        }
+        time_trace.add(std::move(_event));
+    }
+
+  private:
+    bool             _enabled = false;
+    TimeTrace::Event _event;
+    int64_t          _peak_rss_at_start = 0;
+};
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <fmt/format.h>
+
+#include <BuildCache.hpp>
+
+static std::filesystem::path make_test_folder() {
+    const auto test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+    const auto folder = std::filesystem::temp_directory_path() / "lang-tests" / test_info->test_suite_name() / test_info->name();
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder);
+    return folder;
+}
+
+// Inserts an entry as another instance sharing the store would, then ages all of its files.
+static void insert_entry(const std::filesystem::path& root, uint64_t key, std::chrono::minutes age) {
+    BuildCache other_instance(root, 0);
+    const auto interface = root.parent_path() / "interface";
+    std::ofstream(interface) << "interface";
+    const auto temporary_object = other_instance.temporary_object_path(key);
+    std::ofstream(temporary_object) << "object";
+    ASSERT_TRUE(other_instance.insert(key, temporary_object, interface, key).has_value());
+    for(const auto& extension : {".o", ".int", ".meta"})
+        std::filesystem::last_write_time(root / fmt::format("{:016x}{}", key, extension), std::filesystem::file_time_type::clock::now() - age);
+}
+
+static bool has_entry(const std::filesystem::path& root, uint64_t key) {
+    return std::filesystem::exists(root / fmt::format("{:016x}.meta", key)) && std::filesystem::exists(root / fmt::format("{:016x}.o", key));
+}
+
+TEST(BuildCache, EvictionSkipsUsedEntries) {
+    const auto root = make_test_folder() / "store";
+    constexpr uint64_t old_key = 1, recent_key = 2, in_use_key = 3;
+    insert_entry(root, old_key, std::chrono::minutes(120));
+    insert_entry(root, recent_key, std::chrono::minutes(1));
+    insert_entry(root, in_use_key, std::chrono::minutes(120));
+
+    BuildCache cache(root, 0);
+    ASSERT_TRUE(cache.lookup(in_use_key).has_value());
+    // Looking it up touched it: Age it again, it must be kept because this instance uses it.
+    std::filesystem::last_write_time(root / fmt::format("{:016x}.meta", in_use_key), std::filesystem::file_time_type::clock::now() - std::chrono::minutes(120));
+
+    cache.evict();
+    EXPECT_FALSE(has_entry(root, old_key));
+    EXPECT_TRUE(has_entry(root, recent_key));
+    EXPECT_TRUE(has_entry(root, in_use_key));
+    EXPECT_EQ(cache.stats().evicted_entries, 1);
+}
+
+TEST(BuildCache, EvictionInLeastRecentlyUsedOrder) {
+    const auto root = make_test_folder() / "store";
+    insert_entry(root, 1, std::chrono::minutes(60));
+    insert_entry(root, 2, std::chrono::minutes(180));
+    insert_entry(root, 3, std::chrono::minutes(120));
+
+    // Room for a single entry.
+    const auto entry_size = std::filesystem::file_size(root / "0000000000000001.o") + std::filesystem::file_size(root / "0000000000000001.int") +
+                            std::filesystem::file_size(root / "0000000000000001.meta");
+    BuildCache cache(root, entry_size);
+    cache.evict();
+    EXPECT_TRUE(has_entry(root, 1));
+    EXPECT_FALSE(has_entry(root, 2));
+    EXPECT_FALSE(has_entry(root, 3));
+}
+
+// A module reused from the build manifest only touches its entry: It must be protected as if it had been looked up.
+TEST(BuildCache, TouchedEntriesSurviveEviction) {
+    const auto root = make_test_folder() / "store";
+    constexpr uint64_t touched_key = 1, untouched_key = 2;
+    insert_entry(root, touched_key, std::chrono::minutes(120));
+    insert_entry(root, untouched_key, std::chrono::minutes(120));
+
+    BuildCache cache(root, 0);
+    const auto object = cache.touch(touched_key);
+    ASSERT_TRUE(object.has_value());
+    EXPECT_EQ(*object, root / "0000000000000001.o");
+    EXPECT_FALSE(cache.touch(3).has_value());
+
+    cache.evict();
+    EXPECT_TRUE(has_entry(root, touched_key));
+    EXPECT_FALSE(has_entry(root, untouched_key));
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <BuildManifest.hpp>
+
+static std::filesystem::path make_test_folder() {
+    const auto test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+    const auto folder = std::filesystem::temp_directory_path() / "lang-tests" / test_info->test_suite_name() / test_info->name();
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder);
+    return folder;
+}
+
+// Records the current state of source, as after processing it.
+static BuildManifest::Record record_source(BuildManifest& manifest, const std::filesystem::path& source) {
+    BuildManifest::Record record;
+    EXPECT_TRUE(BuildManifest::read_file_status(source, record));
+    record.source_hash = 0x1234;
+    record.inputs_hash = 0x5678;
+    record.interface_hash = 0x9abc;
+    record.object = source.parent_path() / "store" / "0000000000005678.o";
+    record.dependencies = {source.parent_path() / "dependency.lang", source.parent_path() / "other.lang"};
+    record.probes = {{source.parent_path() / "dependency.lang", true}, {source.parent_path() / "other.lang", false}};
+    manifest.update(source, record);
+    return record;
+}
+
+static void expect_equal(const BuildManifest::Record& lhs, const BuildManifest::Record& rhs) {
+    EXPECT_EQ(lhs.source_size, rhs.source_size);
+    EXPECT_EQ(lhs.source_time, rhs.source_time);
+    EXPECT_EQ(lhs.source_hash, rhs.source_hash);
+    EXPECT_EQ(lhs.inputs_hash, rhs.inputs_hash);
+    EXPECT_EQ(lhs.interface_hash, rhs.interface_hash);
+    EXPECT_EQ(lhs.object, rhs.object);
+    EXPECT_EQ(lhs.dependencies, rhs.dependencies);
+    EXPECT_EQ(lhs.probes, rhs.probes);
+}
+
+TEST(BuildManifest, RoundTrip) {
+    const auto folder = make_test_folder();
+    const auto source = folder / "main.lang";
+    std::ofstream(source) << "import \"dependency\"\n";
+
+    BuildManifest manifest;
+    const auto    record = record_source(manifest, source);
+    ASSERT_TRUE(manifest.save(folder / "manifest"));
+
+    BuildManifest loaded;
+    ASSERT_TRUE(loaded.load(folder / "manifest"));
+    const auto found = loaded.find_unchanged(source);
+    ASSERT_TRUE(found.has_value());
+    expect_equal(*found, record);
+    EXPECT_FALSE(loaded.find(folder / "unknown.lang").has_value());
+}
+
+TEST(BuildManifest, IgnoresIncompatibleFiles) {
+    const auto folder = make_test_folder();
+    std::ofstream(folder / "manifest") << "LANGMANI but not quite";
+    BuildManifest manifest;
+    EXPECT_FALSE(manifest.load(folder / "manifest"));
+    EXPECT_TRUE(manifest.load(folder / "missing"));
+}
+
+TEST(BuildManifest, DetectsSizeChanges) {
+    const auto folder = make_test_folder();
+    const auto source = folder / "main.lang";
+    std::ofstream(source) << "import \"dependency\"\n";
+    BuildManifest manifest;
+    record_source(manifest, source);
+
+    const auto time = std::filesystem::last_write_time(source);
+    std::ofstream(source, std::ios::app) << "import \"other\"\n";
+    std::filesystem::last_write_time(source, time);
+    manifest.new_run();
+    EXPECT_FALSE(manifest.find_unchanged(source).has_value());
+    // The last record is still available to compare the content hash.
+    EXPECT_TRUE(manifest.find(source).has_value());
+}
+
+TEST(BuildManifest, DetectsModificationTimeChanges) {
+    const auto folder = make_test_folder();
+    const auto source = folder / "main.lang";
+    std::ofstream(source) << "import \"dependency\"\n";
+    BuildManifest manifest;
+    record_source(manifest, source);
+
+    // Same size.
+    std::ofstream(source) << "import \"Dependency\"\n";
+    std::filesystem::last_write_time(source, std::filesystem::last_write_time(source) + std::chrono::seconds(1));
+    // Files are only checked once per run.
+    EXPECT_TRUE(manifest.find_unchanged(source).has_value());
+    manifest.new_run();
+    EXPECT_FALSE(manifest.find_unchanged(source).has_value());
+}
+
+TEST(BuildManifest, DetectsProbedFilesChanges) {
+    const auto folder = make_test_folder();
+    const auto source = folder / "main.lang";
+    std::ofstream(source) << "import \"dependency\"\n";
+    std::ofstream(folder / "dependency.lang") << "\n";
+    BuildManifest manifest;
+    const auto    record = record_source(manifest, source);
+    EXPECT_TRUE(manifest.probes_unchanged(record));
+
+    // Files are only checked once per run.
+    std::ofstream(folder / "other.lang") << "\n";
+    EXPECT_TRUE(manifest.probes_unchanged(record));
+    manifest.new_run();
+    EXPECT_FALSE(manifest.probes_unchanged(record));
+
+    std::filesystem::remove(folder / "other.lang");
+    std::filesystem::remove(folder / "dependency.lang");
+    manifest.new_run();
+    EXPECT_FALSE(manifest.probes_unchanged(record));
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <DependencyTree.hpp>
+#include <ModuleInterface.hpp>
+
+// Writes each module to a fresh folder, named after the test.
+static std::filesystem::path write_project(const std::vector<std::pair<std::string, std::string>>& modules) {
+    const auto test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+    const auto folder = std::filesystem::temp_directory_path() / "lang-tests" / test_info->test_suite_name() / test_info->name();
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directories(folder);
+    for(const auto& [name, content] : modules)
+        std::ofstream(folder / (name + ".lang")) << content;
+    return folder;
+}
+
+static size_t index_of(const DependencyTree::ProcessingGraph& graph, const std::filesystem::path& path) {
+    return std::find(graph.files.begin(), graph.files.end(), path) - graph.files.begin();
+}
+
+// main imports a and b, which both import base: a is on the critical path and must be scheduled before b.
+TEST(DependencyTree, DiamondCriticalPath) {
+    const auto folder = write_project({
+        {"main", "import \"a\"\nimport \"b\"\nfunction main() : i32 { return 0; }\n"},
+        {"a", "import \"base\"\n"},
+        {"b", "import \"base\"\n"},
+        {"base", "function base() : i32 { return 0; }\n"},
+    });
+    DependencyTree tree;
+    ASSERT_TRUE(tree.construct({folder / "main.lang"}));
+    const auto graph_or_error = tree.generate_processing_graph([&](const std::filesystem::path& path) { return path.stem() == "a" ? 5.0 : 1.0; });
+    ASSERT_FALSE(graph_or_error.is_error());
+    const auto& graph = graph_or_error.get();
+    ASSERT_EQ(graph.size(), 4);
+
+    const auto main = index_of(graph, folder / "main.lang");
+    const auto a = index_of(graph, folder / "a.lang");
+    const auto b = index_of(graph, folder / "b.lang");
+    const auto base = index_of(graph, folder / "base.lang");
+    EXPECT_EQ(graph.dependencies_count[main], 2);
+    EXPECT_EQ(graph.dependencies_count[base], 0);
+    EXPECT_DOUBLE_EQ(graph.priorities[main], 1.0);
+    EXPECT_DOUBLE_EQ(graph.priorities[a], 6.0);
+    EXPECT_DOUBLE_EQ(graph.priorities[b], 2.0);
+    EXPECT_DOUBLE_EQ(graph.priorities[base], 7.0);
+    EXPECT_EQ(graph.order, (std::vector<size_t>{base, a, b, main}));
+}
+
+TEST(DependencyTree, CycleDetection) {
+    const auto folder = write_project({
+        {"main", "import \"a\"\n"},
+        {"a", "import \"b\"\n"},
+        {"b", "import \"a\"\n"},
+    });
+    DependencyTree tree;
+    ASSERT_TRUE(tree.construct({folder / "main.lang"}));
+    const auto graph_or_error = tree.generate_processing_graph();
+    ASSERT_TRUE(graph_or_error.is_error());
+    EXPECT_EQ(graph_or_error.get_error().string(), "Cyclic dependency detected.");
+}
+
+// The scan stops after the leading imports only if no other import follows.
+TEST(DependencyTree, LateImports) {
+    const auto folder = write_project({
+        {"main", "// Header\nimport \"a\"\nfunction f() : i32 { return 0; }\nimport \"b\"\n"},
+        {"a", "function a() : i32 { return 0; }\n"},
+        {"b", "function b() : i32 { return 0; }\n"},
+    });
+    DependencyTree tree;
+    ASSERT_TRUE(tree.construct({folder / "main.lang"}));
+    const auto graph_or_error = tree.generate_processing_graph();
+    ASSERT_FALSE(graph_or_error.is_error());
+    const auto& graph = graph_or_error.get();
+    ASSERT_EQ(graph.size(), 3);
+    EXPECT_EQ(graph.dependencies_count[index_of(graph, folder / "main.lang")], 2);
+}
+
+// Records the scanned files as a successful build would.
+static void record_scans(DependencyTree& tree, BuildManifest& manifest) {
+    const auto graph_or_error = tree.generate_processing_graph();
+    ASSERT_FALSE(graph_or_error.is_error());
+    const auto& graph = graph_or_error.get();
+    for(size_t i = 0; i < graph.size(); ++i) {
+        const auto scan = tree.take_scan(graph.files[i]);
+        ASSERT_NE(scan, nullptr);
+        auto record = scan->file_status;
+        for(const auto dependency : graph.dependencies[i])
+            record.dependencies.push_back(graph.files[dependency]);
+        manifest.update(graph.files[i], std::move(record));
+    }
+}
+
+static std::vector<std::filesystem::path> dependencies_of(const DependencyTree& tree, const std::filesystem::path& path) {
+    const auto  graph_or_error = tree.generate_processing_graph();
+    const auto& graph = graph_or_error.get();
+    std::vector<std::filesystem::path> dependencies;
+    for(const auto dependency : graph.dependencies[index_of(graph, path)])
+        dependencies.push_back(graph.files[dependency]);
+    return dependencies;
+}
+
+// Dependencies recorded in the manifest are only reused if the imports still resolve to the same files.
+TEST(DependencyTree, ManifestShadowingModule) {
+    const auto folder = write_project({{"main", "import \"std/cstr\"\n"}});
+    const auto main = folder / "main.lang";
+    const auto stdlib_module = (stdlib_folder / "std/cstr.lang").lexically_normal();
+    BuildManifest manifest;
+    {
+        DependencyTree tree;
+        tree.set_manifest(&manifest);
+        ASSERT_TRUE(tree.construct({main}));
+        EXPECT_EQ(dependencies_of(tree, main), std::vector{stdlib_module});
+        record_scans(tree, manifest);
+    }
+    {
+        manifest.new_run();
+        DependencyTree tree;
+        tree.set_manifest(&manifest);
+        ASSERT_TRUE(tree.construct({main}));
+        EXPECT_EQ(tree.take_scan(main), nullptr); // Unmodified: Not scanned.
+        EXPECT_EQ(dependencies_of(tree, main), std::vector{stdlib_module});
+    }
+    // A local module now shadows the standard library one.
+    std::filesystem::create_directories(folder / "std");
+    std::ofstream(folder / "std/cstr.lang") << "\n";
+    clear_resolved_dependencies();
+    {
+        manifest.new_run();
+        DependencyTree tree;
+        tree.set_manifest(&manifest);
+        ASSERT_TRUE(tree.construct({main}));
+        EXPECT_EQ(dependencies_of(tree, main), std::vector{folder / "std/cstr.lang"});
+    }
+}
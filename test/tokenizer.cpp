@@ -32,3 +32,32 @@ TEST(Tokenizer, Assignment) {
     EXPECT_EQ(tokens[3].type, Token::Type::Digits);
     EXPECT_EQ(tokens[4].type, Token::Type::EndStatement);
 }
+
+// Runs longer than the blocks of the vectorized scans (and crossing their boundaries) must be skipped as a whole, with the position still tracked.
+TEST(Tokenizer, LongRuns) {
+    const std::string long_identifier(100, 'a');
+    TOKENIZE("let " + long_identifier + "_1 = \"multi\nline \\\" string\";" + std::string(70, ' ') + "\n\t\t\n// " + std::string(50, 'c') + "\n  b");
+    EXPECT_EQ(tokens.size(), 7);
+    EXPECT_EQ(tokens[1].type, Token::Type::Identifier);
+    EXPECT_EQ(tokens[1].value, long_identifier + "_1");
+    EXPECT_EQ(tokens[3].type, Token::Type::StringLiteral);
+    EXPECT_EQ(tokens[3].value, "multi\nline \\\" string");
+    EXPECT_EQ(tokens[5].type, Token::Type::Comment);
+    const LineTable lines(source);
+    EXPECT_EQ(lines.position(tokens[5].offset).line, 3);
+    EXPECT_EQ(lines.position(tokens[5].offset).column, 0);
+    EXPECT_EQ(tokens[6].value, "b");
+    EXPECT_EQ(lines.position(tokens[6].offset).line, 4);
+    EXPECT_EQ(lines.position(tokens[6].offset).column, 2);
+}
+
+// Longest operator first, keywords only on exact matches.
+TEST(Tokenizer, OperatorsAndKeywords) {
+    TOKENIZE("a+++b<=c!==d&&returned||return");
+    const std::vector<Token::Type> expected{Token::Type::Identifier, Token::Type::Increment, Token::Type::Addition, Token::Type::Identifier, Token::Type::LesserOrEqual,
+                                            Token::Type::Identifier, Token::Type::Different, Token::Type::Assignment, Token::Type::Identifier, Token::Type::And,
+                                            Token::Type::Identifier, Token::Type::Or,        Token::Type::Return};
+    ASSERT_EQ(tokens.size(), expected.size());
+    for(size_t i = 0; i < expected.size(); ++i)
+        EXPECT_EQ(tokens[i].type, expected[i]) << "Token " << i << ": " << tokens[i].value;
+}